@@ -43,6 +43,7 @@ public class MultiplayerSessions : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
+				"Icmp",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
@@ -50,7 +50,11 @@ void UMenu::MenuSetup(int32 NumOfPublicConnections, FString TypeOfMatch, FString
     SessionsSubsystem->MultiplayerOnDestroySessionComplete.AddDynamic(this, &ThisClass::OnDestroySession);
 
     SessionsSubsystem->MultiplayerOnFindSessionsComplete.AddUObject(this, &ThisClass::OnFindSessions);
+    SessionsSubsystem->MultiplayerOnFindSessionsPage.AddUObject(this, &ThisClass::OnFindSessionsPage);
     SessionsSubsystem->MultiplayerOnJoinSessionComplete.AddUObject(this, &ThisClass::OnJoinSession);
+
+    // Keeps a server list ready while the menu is up, so Join doesn't have to wait for a search
+    SessionsSubsystem->StartBrowsing(MakeSearchParams());
   }
 }
 
@@ -119,38 +123,53 @@ void UMenu::OnCreateSession(FName SessionName, bool bWasSuccesfull)
 }
 
 void UMenu::OnFindSessions(const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccesfull)
+{
+  // Only reached when no page had a session to join, a join cancels the rest of the search
+  JoinBtn->SetIsEnabled(true);
+}
+
+void UMenu::OnFindSessionsPage(TArrayView<const FOnlineSessionSearchResult> Page, bool bLastPage)
 {
   if (!SessionsSubsystem)
     return;
 
-  for (auto Result : SessionResults)
+  // Results are already filtered and ranked best first, the subsystem falls back to the next ones itself
+  if (Page.Num() > 0)
   {
-    FString SettingsValue;
-    Result.Session.SessionSettings.Get(FName("MatchType"), SettingsValue);
-    
+    const FOnlineSessionSearchResult& Result = Page[0];
     if (GEngine)
     {
       GEngine->AddOnScreenDebugMessage(
         -1,
         120.f,
         FColor::Red,
-        FString::Printf(TEXT("MatchType: %s | Server (ID:%s) by user: %s"), *SettingsValue, *Result.Session.SessionInfo->GetSessionId().ToString(), *Result.Session.OwningUserName)
+        FString::Printf(TEXT("MatchType: %s | Server (ID:%s) by user: %s | Ping: %d ms"), *MatchType, *Result.GetSessionIdStr(), *Result.Session.OwningUserName, Result.PingInMs)
       );
     }
 
-    if (SettingsValue == MatchType)
-    {
-      SessionsSubsystem->JoinSession(Result);
-      return;
-    }
+    SessionsSubsystem->CancelFindSessions();
+    SessionsSubsystem->JoinBestSession();
   }
-
-  if (bWasSuccesfull || SessionResults.IsEmpty())
-    JoinBtn->SetIsEnabled(true);
 }
 
 void UMenu::OnJoinSession(EOnJoinSessionCompleteResult::Type Result)
 {
+  if (Result != EOnJoinSessionCompleteResult::Success)
+  {
+    if (GEngine)
+    {
+      GEngine->AddOnScreenDebugMessage(
+        -1,
+        15.f,
+        FColor::Red,
+        FString::Printf(TEXT("Connection Failed | %d"), Result)
+      );
+    }
+
+    JoinBtn->SetIsEnabled(true);
+    return;
+  }
+
   IOnlineSubsystem* Subsystem = IOnlineSubsystem::Get();
   if (Subsystem)
   {
@@ -168,23 +187,6 @@ void UMenu::OnJoinSession(EOnJoinSessionCompleteResult::Type Result)
       }
     }
   }
-
-  if (Result != EOnJoinSessionCompleteResult::Success)
-  {
-    JoinBtn->SetIsEnabled(true);
-  }
-  else
-  {
-    if (GEngine)
-    {
-      GEngine->AddOnScreenDebugMessage(
-        -1,
-        15.f,
-        FColor::Red,
-        FString::Printf(TEXT("Connection Failed | %d"), Result)
-      );
-    }
-  }
 }
 
 void UMenu::OnStartSession(bool bWasSuccesfull)
@@ -208,6 +210,20 @@ void UMenu::JoinButtonClicked()
 
   if (SessionsSubsystem)
   {
+    if (SessionsSubsystem->JoinCachedSession(MakeSearchParams()))
+    {
+      if (GEngine)
+      {
+        GEngine->AddOnScreenDebugMessage(
+          -1,
+          10.f,
+          FColor::Green,
+          FString::Printf(TEXT("Joining Cached Session"))
+        );
+      }
+      return;
+    }
+
     if (GEngine)
     {
       GEngine->AddOnScreenDebugMessage(
@@ -217,7 +233,7 @@ void UMenu::JoinButtonClicked()
         FString::Printf(TEXT("Searching For Sessions"))
       );
     }
-    SessionsSubsystem->FindSessions(10000);
+    SessionsSubsystem->FindSessions(MakeSearchParams());
   }
   else
   {
@@ -233,8 +249,18 @@ void UMenu::JoinButtonClicked()
   }
 }
 
+FMultiplayerSessionSearchParams UMenu::MakeSearchParams() const
+{
+  FMultiplayerSessionSearchParams SearchParams;
+  SearchParams.MatchType = MatchType;
+  return SearchParams;
+}
+
 void UMenu::MenuTearDown()
 {
+  if (SessionsSubsystem)
+    SessionsSubsystem->StopBrowsing();
+
   RemoveFromParent();
   UWorld* World = GetWorld();
 
@@ -4,6 +4,9 @@
 #include "MultiplayerSessionsSubsystem.h"
 #include "OnlineSubsystem.h"
 #include "OnlineSessionSettings.h"
+#include "MultiplayerSessions.h"
+#include "Icmp.h"
+#include "HAL/IConsoleManager.h"
 
 UMultiplayerSessionsSubsystem::UMultiplayerSessionsSubsystem() :
   CreateSessionCompleteDelegate(FOnCreateSessionCompleteDelegate::CreateUObject(this, &ThisClass::OnCreateSessionComplete)),
@@ -28,24 +31,166 @@ UMultiplayerSessionsSubsystem::UMultiplayerSessionsSubsystem() :
   }
 }
 
+void UMultiplayerSessionsSubsystem::Deinitialize()
+{
+  StopBrowsing();
+  CancelFindSessions();
+  FTSTicker::GetCoreTicker().RemoveTicker(OperationTimeoutHandle);
+
+  Super::Deinitialize();
+}
+
 void UMultiplayerSessionsSubsystem::CreateSession(int32 NumPublicConnections, FString MatchType)
 {
-  if (!SessionInterface.IsValid())
+  // Only the latest host request matters, an older one still waiting would just be destroyed again
+  PendingOps.RemoveAll([](const FMultiplayerSessionOp& Op) { return Op.Type == FMultiplayerSessionOp::EType::Create; });
+
+  FMultiplayerSessionOp Op;
+  Op.Type = FMultiplayerSessionOp::EType::Create;
+  Op.NumPublicConnections = NumPublicConnections;
+  Op.MatchType = MatchType;
+  QueueOp(Op);
+}
+
+void UMultiplayerSessionsSubsystem::DestroySession()
+{
+  FMultiplayerSessionOp Op;
+  Op.Type = FMultiplayerSessionOp::EType::Destroy;
+  QueueOp(Op);
+}
+
+void UMultiplayerSessionsSubsystem::StartSession()
+{
+  FMultiplayerSessionOp Op;
+  Op.Type = FMultiplayerSessionOp::EType::Start;
+  QueueOp(Op);
+}
+
+//
+// Host state machine
+//
+
+void UMultiplayerSessionsSubsystem::QueueOp(const FMultiplayerSessionOp& Op)
+{
+  PendingOps.Add(Op);
+  PumpOps();
+}
+
+bool UMultiplayerSessionsSubsystem::IsSessionBusy() const
+{
+  return SessionState == EMultiplayerSessionState::Destroying
+    || SessionState == EMultiplayerSessionState::Creating
+    || SessionState == EMultiplayerSessionState::Starting;
+}
+
+void UMultiplayerSessionsSubsystem::PumpOps()
+{
+  // Callbacks broadcast from here may queue more ops, the loop below picks them up
+  if (bPumpingOps)
     return;
 
-  const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
+  TGuardValue<bool> PumpGuard(bPumpingOps, true);
+  while (!IsSessionBusy() && PendingOps.Num() > 0)
+  {
+    CurrentOp = PendingOps[0];
+    PendingOps.RemoveAt(0);
+
+    const bool bHasSession = SessionInterface.IsValid() && SessionInterface->GetNamedSession(NAME_GameSession) != nullptr;
+    switch (CurrentOp.Type)
+    {
+    case FMultiplayerSessionOp::EType::Create:
+      // Re-hosting, e.g. after a match: the old session goes first and the create runs from its callback
+      if (bHasSession)
+        BeginDestroySession();
+      else
+        BeginCreateSession();
+      break;
+
+    case FMultiplayerSessionOp::EType::Destroy:
+      if (bHasSession)
+      {
+        BeginDestroySession();
+      }
+      else
+      {
+        SetSessionState(EMultiplayerSessionState::Idle);
+        MultiplayerOnDestroySessionComplete.Broadcast(true);
+      }
+      break;
+
+    case FMultiplayerSessionOp::EType::Start:
+      BeginStartSession();
+      break;
+    }
+  }
+}
+
+void UMultiplayerSessionsSubsystem::SetSessionState(EMultiplayerSessionState NewState)
+{
+  FTSTicker::GetCoreTicker().RemoveTicker(OperationTimeoutHandle);
+
+  if (NewState != SessionState)
+  {
+    UE_LOG(LogMultiplayerSessions, Log, TEXT("Session state %s -> %s"),
+      *UEnum::GetValueAsString(SessionState), *UEnum::GetValueAsString(NewState));
+    SessionState = NewState;
+  }
+
+  if (IsSessionBusy())
+    OperationTimeoutHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::OnOperationTimeout), OperationTimeoutSeconds);
 
-  auto ExistingSession = SessionInterface->GetNamedSession(NAME_GameSession);
+  MultiplayerOnSessionStateChanged.Broadcast(SessionState);
+}
 
-  if (ExistingSession)
+bool UMultiplayerSessionsSubsystem::OnOperationTimeout(float DeltaTime)
+{
+  UE_LOG(LogMultiplayerSessions, Warning, TEXT("%s timed out after %.0f seconds"), *UEnum::GetValueAsString(SessionState), OperationTimeoutSeconds);
+
+  // With the delegate cleared a late reply is ignored, the queue moves on instead of waiting for it
+  switch (SessionState)
   {
-    bCreateSessionOnDestroy = true;
-    LastNumPublicConnections = NumPublicConnections;
-    LastMatchType = MatchType;
+  case EMultiplayerSessionState::Destroying:
+    SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
+    SetSessionState(EMultiplayerSessionState::Idle);
+    if (CurrentOp.Type == FMultiplayerSessionOp::EType::Create)
+      MultiplayerOnCreateSessionComplete.Broadcast(NAME_GameSession, false);
+    else
+      MultiplayerOnDestroySessionComplete.Broadcast(false);
+    break;
+
+  case EMultiplayerSessionState::Creating:
+    SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+    SetSessionState(EMultiplayerSessionState::Idle);
+    MultiplayerOnCreateSessionComplete.Broadcast(NAME_GameSession, false);
+    break;
 
-    DestroySession();
+  case EMultiplayerSessionState::Starting:
+    SessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
+    SetSessionState(EMultiplayerSessionState::InSession);
+    MultiplayerOnStartSessionComplete.Broadcast(false);
+    break;
+
+  default:
+    break;
   }
 
+  PumpOps();
+  return false;
+}
+
+void UMultiplayerSessionsSubsystem::BeginCreateSession()
+{
+  if (!SessionInterface.IsValid())
+  {
+    MultiplayerOnCreateSessionComplete.Broadcast(NAME_GameSession, false);
+    return;
+  }
+
+  const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
+  const int32 NumPublicConnections = CurrentOp.NumPublicConnections;
+  const FString& MatchType = CurrentOp.MatchType;
+
+  SetSessionState(EMultiplayerSessionState::Creating);
   CreateSessionCompleteDelegateHandle = SessionInterface->AddOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegate);
 
   SessionSettings = MakeShareable(new FOnlineSessionSettings());
@@ -56,13 +201,20 @@ void UMultiplayerSessionsSubsystem::CreateSession(int32 NumPublicConnections, FS
   SessionSettings->bShouldAdvertise = true;
   SessionSettings->bUsesPresence = true;
   SessionSettings->Set(FName("MatchType"), MatchType, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
-  SessionSettings->BuildUniqueId = 1;
+  // Searches skip sessions whose build id differs, so clients never see servers they can't join
+  SessionSettings->BuildUniqueId = GetBuildUniqueId();
 
   //If you cannot find sessions try this on session settings
   SessionSettings->bUseLobbiesIfAvailable = true;
 
   if (!SessionInterface->CreateSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, *SessionSettings))
   {
+    SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+
+    // Some services report the failure through the delegate before returning
+    if (SessionState != EMultiplayerSessionState::Creating)
+      return;
+
     if (GEngine)
     {
       GEngine->AddOnScreenDebugMessage(
@@ -72,25 +224,115 @@ void UMultiplayerSessionsSubsystem::CreateSession(int32 NumPublicConnections, FS
         FString::Printf(TEXT("Create Session Failed")));
     }
 
-    SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+    SetSessionState(EMultiplayerSessionState::Idle);
 
     // Broadcast custom delegates
     MultiplayerOnCreateSessionComplete.Broadcast(NAME_GameSession, false);
   }
 }
 
-void UMultiplayerSessionsSubsystem::FindSessions(int32 MaxSearchResults)
+void UMultiplayerSessionsSubsystem::BeginDestroySession()
 {
   if (!SessionInterface.IsValid())
+  {
+    MultiplayerOnDestroySessionComplete.Broadcast(false);
+    return;
+  }
+
+  if (CurrentOp.Type == FMultiplayerSessionOp::EType::Create && GEngine)
+  {
+    GEngine->AddOnScreenDebugMessage(
+      -1,
+      15.f,
+      FColor::Yellow,
+      FString::Printf(TEXT("Session with the same name is exists, recreating...")));
+  }
+
+  SetSessionState(EMultiplayerSessionState::Destroying);
+  DestroySessionCompleteDelegateHandle = SessionInterface->AddOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegate);
+
+  if (!SessionInterface->DestroySession(NAME_GameSession))
+  {
+    SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
+    if (SessionState != EMultiplayerSessionState::Destroying)
+      return;
+
+    SetSessionState(EMultiplayerSessionState::Idle);
+
+    if (CurrentOp.Type == FMultiplayerSessionOp::EType::Create)
+      MultiplayerOnCreateSessionComplete.Broadcast(NAME_GameSession, false);
+    else
+      MultiplayerOnDestroySessionComplete.Broadcast(false);
+  }
+}
+
+void UMultiplayerSessionsSubsystem::BeginStartSession()
+{
+  const FNamedOnlineSession* Session = SessionInterface.IsValid() ? SessionInterface->GetNamedSession(NAME_GameSession) : nullptr;
+  if (!Session)
+  {
+    SetSessionState(EMultiplayerSessionState::Idle);
+    MultiplayerOnStartSessionComplete.Broadcast(false);
     return;
+  }
 
+  if (Session->SessionState == EOnlineSessionState::InProgress)
+  {
+    SetSessionState(EMultiplayerSessionState::InSession);
+    MultiplayerOnStartSessionComplete.Broadcast(true);
+    return;
+  }
+
+  SetSessionState(EMultiplayerSessionState::Starting);
+  StartSessionCompleteDelegateHandle = SessionInterface->AddOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegate);
+
+  if (!SessionInterface->StartSession(NAME_GameSession))
+  {
+    SessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
+    if (SessionState != EMultiplayerSessionState::Starting)
+      return;
+
+    // The session is still there, just not started
+    SetSessionState(EMultiplayerSessionState::InSession);
+    MultiplayerOnStartSessionComplete.Broadcast(false);
+  }
+}
+
+void UMultiplayerSessionsSubsystem::FindSessions(const FMultiplayerSessionSearchParams& Params)
+{
+  if (!SessionInterface.IsValid())
+    return;
+
+  // A new search replaces the running one, a background refresh included
+  if (bSearching)
+    CancelFindSessions();
+
+  if (!StartSearch(Params))
+    MultiplayerOnFindSessionsComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+}
+
+bool UMultiplayerSessionsSubsystem::StartSearch(const FMultiplayerSessionSearchParams& Params)
+{
   FindSessionsCompleteDelegateHandle = SessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate);
 
+  SearchParams = Params;
+  SearchParams.PageSize = FMath::Max(SearchParams.PageSize, 1);
+
   SessionSearch = MakeShareable(new FOnlineSessionSearch());
-  SessionSearch->MaxSearchResults = MaxSearchResults;
+  SessionSearch->MaxSearchResults = Params.MaxSearchResults;
+  SessionSearch->TimeoutInSeconds = Params.TimeoutSeconds;
   SessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
   SessionSearch->bIsLanQuery = IOnlineSubsystem::Get()->GetSubsystemName() == "NULL";
 
+  if (!Params.MatchType.IsEmpty())
+    SessionSearch->QuerySettings.Set(FName("MatchType"), Params.MatchType, EOnlineComparisonOp::Equals);
+
+  if (Params.MinFreeSlots > 0)
+    SessionSearch->QuerySettings.Set(SEARCH_MINSLOTSAVAILABLE, Params.MinFreeSlots, EOnlineComparisonOp::GreaterThanEquals);
+
+  bSearching = true;
+  SearchTimeoutHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::OnSearchTimeout), Params.TimeoutSeconds);
+
   const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
   if (!SessionInterface->FindSessions(*LocalPlayer->GetPreferredUniqueNetId(), SessionSearch.ToSharedRef()))
   {
@@ -106,58 +348,481 @@ void UMultiplayerSessionsSubsystem::FindSessions(int32 MaxSearchResults)
 
     SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
 
-    MultiplayerOnFindSessionsComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+    bSearching = false;
+    FTSTicker::GetCoreTicker().RemoveTicker(SearchTimeoutHandle);
+    return false;
   }
+
+  return true;
 }
 
-void UMultiplayerSessionsSubsystem::JoinSession(const FOnlineSessionSearchResult& SessionResult)
+void UMultiplayerSessionsSubsystem::CancelFindSessions()
 {
-  if (!SessionInterface.IsValid())
+  if (!bSearching)
+    return;
+
+  bSearching = false;
+  bRefreshing = false;
+  FTSTicker::GetCoreTicker().RemoveTicker(SearchTimeoutHandle);
+  FTSTicker::GetCoreTicker().RemoveTicker(PageTickerHandle);
+  FTSTicker::GetCoreTicker().RemoveTicker(ProbeTimeoutHandle);
+  ++ProbeGeneration;
+
+  // Only the online search itself needs cancelling, results being paged out are already here
+  if (SessionInterface.IsValid() && SessionSearch.IsValid() && SessionSearch->SearchState == EOnlineAsyncTaskState::InProgress)
   {
-    MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+    SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+    SessionInterface->CancelFindSessions();
+  }
+}
+
+bool UMultiplayerSessionsSubsystem::OnSearchTimeout(float DeltaTime)
+{
+  if (GEngine && !bRefreshing)
+  {
+    GEngine->AddOnScreenDebugMessage(
+      -1,
+      10.f,
+      FColor::Yellow,
+      FString::Printf(TEXT("Session search timed out after %.0f seconds"), SearchParams.TimeoutSeconds)
+    );
+  }
+
+  if (SessionInterface.IsValid())
+  {
+    SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+    SessionInterface->CancelFindSessions();
+  }
+
+  // Whatever came in before the timeout is still worth handing out
+  ProcessSearchResults();
+  return false;
+}
+
+void UMultiplayerSessionsSubsystem::ProcessSearchResults()
+{
+  FTSTicker::GetCoreTicker().RemoveTicker(SearchTimeoutHandle);
+
+  FilterSearchResults();
+
+  if (SessionSearch->SearchResults.IsEmpty())
+  {
+    if (bRefreshing)
+    {
+      DeliverResults();
+      return;
+    }
+
+    if (GEngine)
+    {
+      GEngine->AddOnScreenDebugMessage(
+        -1,
+        10.f,
+        FColor::Red,
+        FString::Printf(TEXT("Search results is empty"))
+      );
+    }
+    FinishSearch(false);
     return;
   }
 
-  SessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
+  RankSessions(SessionSearch->SearchResults);
+
+  if (NumProbeCandidates > 0)
+    ProbeCandidates();
+  else
+    DeliverResults();
+}
+
+void UMultiplayerSessionsSubsystem::DeliverResults()
+{
+  // Only after probing, a directly measured ping can bring a session back under the cutoff
+  ApplyPingCutoff(SessionSearch->SearchResults);
+
+  UpdateSessionCache();
+
+  if (bRefreshing)
+  {
+    FinishRefresh();
+    return;
+  }
+
+  if (SessionSearch->SearchResults.IsEmpty())
+  {
+    FinishSearch(false);
+    return;
+  }
+
+  // The first page goes out right away, the rest one per frame unless the receiver cancels
+  NextPageIndex = 0;
+  if (DeliverNextPage(0.f))
+    PageTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::DeliverNextPage));
+}
+
+void UMultiplayerSessionsSubsystem::FilterSearchResults()
+{
+  // In place, services that ignore part of the query (LAN) must not leak results past it
+  SessionSearch->SearchResults.RemoveAllSwap([this](const FOnlineSessionSearchResult& Result)
+  {
+    return !MatchesSearchParams(Result, SearchParams);
+  });
+}
+
+bool UMultiplayerSessionsSubsystem::MatchesSearchParams(const FOnlineSessionSearchResult& Result, const FMultiplayerSessionSearchParams& Params) const
+{
+  if (!Result.IsValid() || Result.Session.NumOpenPublicConnections < Params.MinFreeSlots)
+    return false;
+
+  if (Params.MatchType.IsEmpty())
+    return true;
+
+  FString SettingsValue;
+  Result.Session.SessionSettings.Get(FName("MatchType"), SettingsValue);
+  return SettingsValue == Params.MatchType;
+}
+
+bool UMultiplayerSessionsSubsystem::DeliverNextPage(float DeltaTime)
+{
+  if (!bSearching)
+    return false;
+
+  const TArray<FOnlineSessionSearchResult>& Results = SessionSearch->SearchResults;
+  const int32 First = NextPageIndex * SearchParams.PageSize;
+  const int32 Num = FMath::Min(SearchParams.PageSize, Results.Num() - First);
+  const bool bLastPage = First + Num >= Results.Num();
+  ++NextPageIndex;
+
+  MultiplayerOnFindSessionsPage.Broadcast(TArrayView<const FOnlineSessionSearchResult>(Results.GetData() + First, Num), bLastPage);
+
+  // A receiver that found what it wanted cancels the search from the broadcast
+  if (!bSearching)
+    return false;
+
+  if (bLastPage)
+  {
+    FinishSearch(true);
+    return false;
+  }
+
+  return true;
+}
+
+void UMultiplayerSessionsSubsystem::FinishSearch(bool bWasSuccesfull)
+{
+  bSearching = false;
+  FTSTicker::GetCoreTicker().RemoveTicker(SearchTimeoutHandle);
+  FTSTicker::GetCoreTicker().RemoveTicker(PageTickerHandle);
+  FTSTicker::GetCoreTicker().RemoveTicker(ProbeTimeoutHandle);
+
+  MultiplayerOnFindSessionsComplete.Broadcast(SessionSearch->SearchResults, bWasSuccesfull);
+}
+
+void UMultiplayerSessionsSubsystem::JoinSession(const FOnlineSessionSearchResult& SessionResult)
+{
+  bJoiningBest = false;
+
+  if (!StartJoin(SessionResult))
+    MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+}
+
+bool UMultiplayerSessionsSubsystem::StartJoin(const FOnlineSessionSearchResult& SessionResult)
+{
+  if (!SessionInterface.IsValid())
+    return false;
+
+  JoinSessionCompleteDelegateHandle = SessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
 
   const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
   if (!SessionInterface->JoinSession(*LocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, SessionResult))
   {
     SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+    return false;
+  }
 
-    MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+  return true;
+}
+
+void UMultiplayerSessionsSubsystem::JoinBestSession()
+{
+  JoinCandidates.Reset();
+  if (SessionSearch.IsValid())
+    JoinCandidates = SessionSearch->SearchResults;
+
+  StartJoinCandidates();
+}
+
+bool UMultiplayerSessionsSubsystem::JoinCachedSession(const FMultiplayerSessionSearchParams& Params)
+{
+  JoinCandidates.Reset();
+  for (const TPair<FString, FMultiplayerCachedSession>& Cached : SessionCache)
+  {
+    if (MatchesSearchParams(Cached.Value.Result, Params))
+      JoinCandidates.Add(Cached.Value.Result);
   }
+
+  RankSessions(JoinCandidates);
+  ApplyPingCutoff(JoinCandidates);
+
+  if (JoinCandidates.IsEmpty())
+    return false;
+
+  // The cache may be stale, a fresh search runs alongside the join and drops candidates that went away
+  RefreshSessionCache(Params);
+
+  StartJoinCandidates();
+  return true;
 }
 
-void UMultiplayerSessionsSubsystem::DestroySession()
+void UMultiplayerSessionsSubsystem::StartJoinCandidates()
 {
-  if (!SessionInterface.IsValid())
+  bJoiningBest = true;
+  JoinCandidateIndex = 0;
+  NumJoinAttempts = 0;
+
+  if (!JoinNextCandidate())
   {
-    MultiplayerOnDestroySessionComplete.Broadcast(false);
+    bJoiningBest = false;
+    MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::SessionDoesNotExist);
+  }
+}
+
+bool UMultiplayerSessionsSubsystem::JoinNextCandidate()
+{
+  // Candidates are ranked best first, see RankSessions
+  while (JoinCandidateIndex < JoinCandidates.Num() && NumJoinAttempts < MaxJoinAttempts)
+  {
+    const FOnlineSessionSearchResult& Candidate = JoinCandidates[JoinCandidateIndex++];
+    ++NumJoinAttempts;
+
+    UE_LOG(LogMultiplayerSessions, Log, TEXT("Joining %s, rank %d, attempt %d: ping %d ms, %d free slots, score %.1f"),
+      *Candidate.GetSessionIdStr(), JoinCandidateIndex, NumJoinAttempts, Candidate.PingInMs, Candidate.Session.NumOpenPublicConnections, ScoreSession(Candidate));
+
+    if (StartJoin(Candidate))
+      return true;
+  }
+
+  return false;
+}
+
+//
+// Best server selection
+//
+
+float UMultiplayerSessionsSubsystem::ScoreSession(const FOnlineSessionSearchResult& Result) const
+{
+  const int32 FreeSlots = Result.Session.NumOpenPublicConnections;
+  const int32 Players = FMath::Max(Result.Session.SessionSettings.NumPublicConnections - FreeSlots, 0);
+
+  return FreeSlotWeight * FreeSlots + PopulationWeight * Players - PingWeight * Result.PingInMs;
+}
+
+void UMultiplayerSessionsSubsystem::RankSessions(TArray<FOnlineSessionSearchResult>& Results) const
+{
+  // Every result is scored once up front, the comparator only compares the scores
+  TArray<TPair<float, int32>> Ranking;
+  Ranking.Reserve(Results.Num());
+  for (int32 Index = 0; Index < Results.Num(); ++Index)
+    Ranking.Emplace(ScoreSession(Results[Index]), Index);
+
+  Ranking.StableSort([](const TPair<float, int32>& A, const TPair<float, int32>& B)
+  {
+    return A.Key > B.Key;
+  });
+
+  TArray<FOnlineSessionSearchResult> Ranked;
+  Ranked.Reserve(Results.Num());
+  for (const TPair<float, int32>& Entry : Ranking)
+    Ranked.Add(MoveTemp(Results[Entry.Value]));
+  Results = MoveTemp(Ranked);
+
+  for (int32 Index = 0; Index < Results.Num() && Index < 5; ++Index)
+  {
+    const FOnlineSessionSearchResult& Result = Results[Index];
+    UE_LOG(LogMultiplayerSessions, Log, TEXT("Rank %d: %s ping %d ms, %d/%d free slots, score %.1f"),
+      Index + 1, *Result.GetSessionIdStr(), Result.PingInMs, Result.Session.NumOpenPublicConnections,
+      Result.Session.SessionSettings.NumPublicConnections, Ranking[Index].Key);
+  }
+}
+
+void UMultiplayerSessionsSubsystem::ApplyPingCutoff(TArray<FOnlineSessionSearchResult>& Results) const
+{
+  if (MaxPingMs <= 0)
     return;
+
+  // Keeps the ranking order; a result whose ping was never measured reports MAX_QUERY_PING and is kept, unknown is not slow
+  const int32 NumRemoved = Results.RemoveAll([this](const FOnlineSessionSearchResult& Result)
+  {
+    return Result.PingInMs < MAX_QUERY_PING && Result.PingInMs > MaxPingMs;
+  });
+
+  if (NumRemoved > 0)
+    UE_LOG(LogMultiplayerSessions, Log, TEXT("Dropped %d sessions over %d ms"), NumRemoved, MaxPingMs);
+}
+
+void UMultiplayerSessionsSubsystem::ProbeCandidates()
+{
+  ++ProbeGeneration;
+
+  // Held until every probe has been sent, so a probe failing right away can't finish the round early
+  NumProbesPending = 1;
+
+  const TArray<FOnlineSessionSearchResult>& Results = SessionSearch->SearchResults;
+  const int32 NumProbes = FMath::Min(NumProbeCandidates, Results.Num());
+  for (int32 Index = 0; Index < NumProbes; ++Index)
+  {
+    // Only sessions with an IP address can be pinged, e.g. not Steam P2P ones; those keep their reported ping
+    FString ConnectString;
+    if (!SessionInterface->GetResolvedConnectString(Results[Index], NAME_GamePort, ConnectString))
+      continue;
+
+    FString Host = ConnectString;
+    ConnectString.Split(TEXT(":"), &Host, nullptr, ESearchCase::IgnoreCase, ESearchDir::FromEnd);
+
+    ++NumProbesPending;
+    TWeakObjectPtr<UMultiplayerSessionsSubsystem> WeakThis(this);
+    const int32 Generation = ProbeGeneration;
+    FIcmp::IcmpEcho(Host, ProbeTimeoutSeconds, [WeakThis, Generation, Index](FIcmpEchoResult EchoResult)
+    {
+      if (WeakThis.IsValid())
+        WeakThis->OnProbeComplete(Generation, Index, EchoResult.Status == EIcmpResponseStatus::Success, EchoResult.Time * 1000.f);
+    });
   }
 
-  DestroySessionCompleteDelegateHandle = SessionInterface->AddOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegate);
+  ProbeTimeoutHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::OnProbeTimeout), ProbeTimeoutSeconds * 2.f);
+  OnProbeComplete(ProbeGeneration, INDEX_NONE, false, 0.f);
+}
 
-  if (GEngine)
+void UMultiplayerSessionsSubsystem::OnProbeComplete(int32 Generation, int32 ResultIndex, bool bSuccess, float PingMs)
+{
+  if (Generation != ProbeGeneration || !bSearching)
+    return;
+
+  if (bSuccess && SessionSearch->SearchResults.IsValidIndex(ResultIndex))
   {
-    GEngine->AddOnScreenDebugMessage(
-      -1,
-      15.f,
-      FColor::Yellow,
-      FString::Printf(TEXT("Session with the same name is exists, recreating...")));
+    FOnlineSessionSearchResult& Result = SessionSearch->SearchResults[ResultIndex];
+    UE_LOG(LogMultiplayerSessions, Log, TEXT("Probed %s: %.0f ms, reported %d ms"), *Result.GetSessionIdStr(), PingMs, Result.PingInMs);
+    Result.PingInMs = FMath::RoundToInt(PingMs);
   }
 
-  if (!SessionInterface->DestroySession(NAME_GameSession))
+  if (--NumProbesPending > 0)
+    return;
+
+  FTSTicker::GetCoreTicker().RemoveTicker(ProbeTimeoutHandle);
+  RankSessions(SessionSearch->SearchResults);
+  DeliverResults();
+}
+
+bool UMultiplayerSessionsSubsystem::OnProbeTimeout(float DeltaTime)
+{
+  // Late probe results belong to an old generation and are ignored
+  ++ProbeGeneration;
+  NumProbesPending = 0;
+
+  UE_LOG(LogMultiplayerSessions, Log, TEXT("Probes timed out, ranking with the pings measured so far"));
+  RankSessions(SessionSearch->SearchResults);
+  DeliverResults();
+  return false;
+}
+
+//
+// Session cache
+//
+
+void UMultiplayerSessionsSubsystem::StartBrowsing(const FMultiplayerSessionSearchParams& Params)
+{
+  BrowseParams = Params;
+  bBrowsing = true;
+
+  FTSTicker::GetCoreTicker().RemoveTicker(RefreshTickerHandle);
+  RefreshTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::OnRefreshTick), FMath::Max(RefreshIntervalSeconds, 1.f));
+
+  RefreshSessionCache(BrowseParams);
+}
+
+void UMultiplayerSessionsSubsystem::StopBrowsing()
+{
+  if (!bBrowsing)
+    return;
+
+  bBrowsing = false;
+  FTSTicker::GetCoreTicker().RemoveTicker(RefreshTickerHandle);
+
+  // A search someone is waiting on keeps running, the cache itself stays until it ages out
+  if (bRefreshing)
+    CancelFindSessions();
+}
+
+bool UMultiplayerSessionsSubsystem::OnRefreshTick(float DeltaTime)
+{
+  RefreshSessionCache(BrowseParams);
+  return true;
+}
+
+void UMultiplayerSessionsSubsystem::RefreshSessionCache(const FMultiplayerSessionSearchParams& Params)
+{
+  // Any search in flight fills the cache when it is done
+  if (bSearching || !SessionInterface.IsValid())
+    return;
+
+  bRefreshing = true;
+  if (!StartSearch(Params))
+    bRefreshing = false;
+}
+
+void UMultiplayerSessionsSubsystem::UpdateSessionCache()
+{
+  const double Now = FPlatformTime::Seconds();
+  for (const FOnlineSessionSearchResult& Result : SessionSearch->SearchResults)
   {
-    SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
-    MultiplayerOnDestroySessionComplete.Broadcast(false);
+    FMultiplayerCachedSession& Cached = SessionCache.FindOrAdd(Result.GetSessionIdStr());
+    Cached.Result = Result;
+    Cached.LastSeenTime = Now;
+  }
+
+  // One missed reply is not enough to drop a session, a few refreshes in a row are
+  for (TMap<FString, FMultiplayerCachedSession>::TIterator It = SessionCache.CreateIterator(); It; ++It)
+  {
+    if (Now - It.Value().LastSeenTime > CacheMaxAgeSeconds)
+      It.RemoveCurrent();
   }
 }
 
-void UMultiplayerSessionsSubsystem::StartSession()
+void UMultiplayerSessionsSubsystem::FinishRefresh()
 {
+  bSearching = false;
+  bRefreshing = false;
+  FTSTicker::GetCoreTicker().RemoveTicker(SearchTimeoutHandle);
+  FTSTicker::GetCoreTicker().RemoveTicker(ProbeTimeoutHandle);
+
+  // Only a search that ran to completion proves a session is gone, a timed out one may have missed it
+  if (bJoiningBest && SessionSearch->SearchState == EOnlineAsyncTaskState::Done)
+    PruneJoinCandidates();
 
+  UE_LOG(LogMultiplayerSessions, Verbose, TEXT("Session cache refreshed, %d sessions"), SessionCache.Num());
+  MultiplayerOnSessionCacheUpdated.Broadcast();
+}
+
+void UMultiplayerSessionsSubsystem::PruneJoinCandidates()
+{
+  // Candidates not tried yet are replaced by their fresh state, or dropped when the host is gone
+  for (int32 Index = JoinCandidates.Num() - 1; Index >= JoinCandidateIndex; --Index)
+  {
+    const FString SessionId = JoinCandidates[Index].GetSessionIdStr();
+    const FOnlineSessionSearchResult* Fresh = SessionSearch->SearchResults.FindByPredicate([&SessionId](const FOnlineSessionSearchResult& Result)
+    {
+      return Result.GetSessionIdStr() == SessionId;
+    });
+
+    if (Fresh)
+    {
+      JoinCandidates[Index] = *Fresh;
+    }
+    else
+    {
+      UE_LOG(LogMultiplayerSessions, Log, TEXT("Cached session %s is gone, dropping it from the join candidates"), *SessionId);
+      JoinCandidates.RemoveAt(Index);
+    }
+  }
 }
 
 //
@@ -169,7 +834,18 @@ void UMultiplayerSessionsSubsystem::OnCreateSessionComplete(FName SessionName, b
   if (SessionInterface)
     SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
 
+  if (SessionState != EMultiplayerSessionState::Creating)
+    return;
+
+  // Listeners travel to the lobby right away, starting the session doesn't hold that up
   MultiplayerOnCreateSessionComplete.Broadcast(SessionName, bIsWasSuccesfull);
+
+  if (bIsWasSuccesfull)
+    BeginStartSession();
+  else
+    SetSessionState(EMultiplayerSessionState::Idle);
+
+  PumpOps();
 }
 
 void UMultiplayerSessionsSubsystem::OnFindSessionsComplete(bool bIsWasSuccesfull)
@@ -177,22 +853,11 @@ void UMultiplayerSessionsSubsystem::OnFindSessionsComplete(bool bIsWasSuccesfull
   if (SessionInterface)
     SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
 
-  if (SessionSearch->SearchResults.IsEmpty())
-  {
-    if (GEngine)
-    {
-      GEngine->AddOnScreenDebugMessage(
-        -1,
-        10.f,
-        FColor::Red,
-        FString::Printf(TEXT("Search results is empty"))
-      );
-    }
-    MultiplayerOnFindSessionsComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+  // Cancelled or timed out in the meantime
+  if (!bSearching)
     return;
-  }
 
-  MultiplayerOnFindSessionsComplete.Broadcast(SessionSearch->SearchResults, true);
+  ProcessSearchResults();
 }
 
 void UMultiplayerSessionsSubsystem::OnJoinSessionComplete(FName SessionName, EOnJoinSessionCompleteResult::Type Result)
@@ -202,6 +867,15 @@ void UMultiplayerSessionsSubsystem::OnJoinSessionComplete(FName SessionName, EOn
     SessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
   }
 
+  // A full or vanished host is not the end, the next best candidate gets a go
+  if (bJoiningBest && Result != EOnJoinSessionCompleteResult::Success && Result != EOnJoinSessionCompleteResult::AlreadyInSession)
+  {
+    UE_LOG(LogMultiplayerSessions, Warning, TEXT("Join failed with result %d"), static_cast<int32>(Result));
+    if (JoinNextCandidate())
+      return;
+  }
+
+  bJoiningBest = false;
   MultiplayerOnJoinSessionComplete.Broadcast(Result);
 }
 
@@ -210,17 +884,57 @@ void UMultiplayerSessionsSubsystem::OnDestroySessionComplete(FName SessionName,
   if (SessionInterface)
     SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
 
-  if (bIsWasSuccesfull && bCreateSessionOnDestroy)
-  {
-    bCreateSessionOnDestroy = false;
+  if (SessionState != EMultiplayerSessionState::Destroying)
+    return;
 
-    const ULocalPlayer* LocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-    CreateSession(LastNumPublicConnections, LastMatchType);
+  SetSessionState(EMultiplayerSessionState::Idle);
+
+  if (CurrentOp.Type == FMultiplayerSessionOp::EType::Create)
+  {
+    // The destroy was only the first half of a re-host
+    if (bIsWasSuccesfull)
+      BeginCreateSession();
+    else
+      MultiplayerOnCreateSessionComplete.Broadcast(NAME_GameSession, false);
+  }
+  else
+  {
+    MultiplayerOnDestroySessionComplete.Broadcast(bIsWasSuccesfull);
   }
 
-  MultiplayerOnDestroySessionComplete.Broadcast(bIsWasSuccesfull);
+  PumpOps();
 }
 
 void UMultiplayerSessionsSubsystem::OnStartSessionComplete(FName SessionName, bool bIsWasSuccesfull)
 {
+  if (SessionInterface)
+    SessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
+
+  if (SessionState != EMultiplayerSessionState::Starting)
+    return;
+
+  SetSessionState(EMultiplayerSessionState::InSession);
+  MultiplayerOnStartSessionComplete.Broadcast(bIsWasSuccesfull);
+  PumpOps();
 }
+
+//
+// Queues host requests back to back. The first one runs right away and the rest coalesce into a single queued
+// request, so however many there are only two hosts run: on top of a live session the log should show two destroy
+// and create cycles, as MultiplayerSessions.StateMachine.Rehost checks. Without a session the first one only creates
+//
+static FAutoConsoleCommandWithWorldAndArgs RehostCommand(
+  TEXT("MultiplayerSessions.Rehost"),
+  TEXT("Queues host requests back to back to exercise the session state machine. Usage: MultiplayerSessions.Rehost [Count] [MatchType]"),
+  FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+  {
+    UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+    UMultiplayerSessionsSubsystem* SessionsSubsystem = GameInstance ? GameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+    if (!SessionsSubsystem)
+      return;
+
+    const int32 Count = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 3;
+    const FString MatchType = Args.Num() > 1 ? Args[1] : FString(TEXT("FreeForAll"));
+    for (int32 Index = 0; Index < Count; ++Index)
+      SessionsSubsystem->CreateSession(4, MatchType);
+  }));
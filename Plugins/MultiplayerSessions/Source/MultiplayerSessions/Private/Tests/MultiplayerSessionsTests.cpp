@@ -0,0 +1,333 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "OnlineSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//
+// These drive the real subsystem of a running game against the NULL online subsystem, e.g.
+//   UnrealEditor Blaster.uproject -game -nosteam -ExecCmds="Automation RunTests MultiplayerSessions"
+// or from the Session Frontend while playing in editor.
+//
+
+namespace MultiplayerSessionsTests
+{
+  static const FString TestMatchType(TEXT("AutomationTest"));
+
+  static UMultiplayerSessionsSubsystem* FindSubsystem()
+  {
+    if (!GEngine)
+      return nullptr;
+
+    for (const FWorldContext& Context : GEngine->GetWorldContexts())
+    {
+      if ((Context.WorldType == EWorldType::Game || Context.WorldType == EWorldType::PIE) && Context.OwningGameInstance)
+        return Context.OwningGameInstance->GetSubsystem<UMultiplayerSessionsSubsystem>();
+    }
+
+    return nullptr;
+  }
+
+  //
+  // Records what the subsystem goes through while a test runs. The listeners it had before, the menu
+  // among them, are set aside meanwhile so a test session never travels anywhere.
+  //
+  struct FSessionTestContext
+  {
+    TWeakObjectPtr<UMultiplayerSessionsSubsystem> Subsystem;
+
+    TArray<EMultiplayerSessionState> States;
+    int32 NumFindCompletes = 0;
+    int32 NumFindPages = 0;
+    FDelegateHandle StateChangedHandle;
+
+    FMultiplayerOnCreateSessionComplete SavedOnCreateSessionComplete;
+    FMultiplayerOnStartSessionComplete SavedOnStartSessionComplete;
+    FMultiplayerOnDestroySessionComplete SavedOnDestroySessionComplete;
+    FMultiplayerOnFindSessionsComplete SavedOnFindSessionsComplete;
+    FMultiplayerOnFindSessionsPage SavedOnFindSessionsPage;
+    FMultiplayerOnJoinSessionComplete SavedOnJoinSessionComplete;
+
+    bool Begin(FAutomationTestBase& Test)
+    {
+      UMultiplayerSessionsSubsystem* SessionsSubsystem = FindSubsystem();
+      if (!SessionsSubsystem)
+      {
+        Test.AddError(TEXT("No game instance with a UMultiplayerSessionsSubsystem, run the game with -game or play in editor"));
+        return false;
+      }
+
+      const IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get();
+      if (!OnlineSubsystem || OnlineSubsystem->GetSubsystemName() != NULL_SUBSYSTEM)
+      {
+        Test.AddError(TEXT("Needs the NULL online subsystem, run with -nosteam"));
+        return false;
+      }
+
+      Subsystem = SessionsSubsystem;
+
+      // A background refresh would start searches of its own
+      SessionsSubsystem->StopBrowsing();
+      SessionsSubsystem->CancelFindSessions();
+
+      SavedOnCreateSessionComplete = MoveTemp(SessionsSubsystem->MultiplayerOnCreateSessionComplete);
+      SavedOnStartSessionComplete = MoveTemp(SessionsSubsystem->MultiplayerOnStartSessionComplete);
+      SavedOnDestroySessionComplete = MoveTemp(SessionsSubsystem->MultiplayerOnDestroySessionComplete);
+      SavedOnFindSessionsComplete = MoveTemp(SessionsSubsystem->MultiplayerOnFindSessionsComplete);
+      SavedOnFindSessionsPage = MoveTemp(SessionsSubsystem->MultiplayerOnFindSessionsPage);
+      SavedOnJoinSessionComplete = MoveTemp(SessionsSubsystem->MultiplayerOnJoinSessionComplete);
+      SessionsSubsystem->MultiplayerOnCreateSessionComplete.Clear();
+      SessionsSubsystem->MultiplayerOnStartSessionComplete.Clear();
+      SessionsSubsystem->MultiplayerOnDestroySessionComplete.Clear();
+      SessionsSubsystem->MultiplayerOnFindSessionsComplete.Clear();
+      SessionsSubsystem->MultiplayerOnFindSessionsPage.Clear();
+      SessionsSubsystem->MultiplayerOnJoinSessionComplete.Clear();
+
+      // Only transitions, the subsystem also broadcasts when a state is entered again
+      StateChangedHandle = SessionsSubsystem->MultiplayerOnSessionStateChanged.AddLambda([this](EMultiplayerSessionState State)
+      {
+        if (States.IsEmpty() || States.Last() != State)
+          States.Add(State);
+      });
+
+      // Dropped with the rest of the test's listeners when End puts the saved ones back
+      SessionsSubsystem->MultiplayerOnFindSessionsComplete.AddLambda([this](const TArray<FOnlineSessionSearchResult>& Results, bool bWasSuccesfull)
+      {
+        ++NumFindCompletes;
+      });
+
+      SessionsSubsystem->MultiplayerOnFindSessionsPage.AddLambda([this](TArrayView<const FOnlineSessionSearchResult> Page, bool bLastPage)
+      {
+        ++NumFindPages;
+      });
+
+      return true;
+    }
+
+    void End()
+    {
+      UMultiplayerSessionsSubsystem* SessionsSubsystem = Subsystem.Get();
+      if (!SessionsSubsystem)
+        return;
+
+      SessionsSubsystem->CancelFindSessions();
+      SessionsSubsystem->MultiplayerOnSessionStateChanged.Remove(StateChangedHandle);
+
+      SessionsSubsystem->MultiplayerOnCreateSessionComplete = MoveTemp(SavedOnCreateSessionComplete);
+      SessionsSubsystem->MultiplayerOnStartSessionComplete = MoveTemp(SavedOnStartSessionComplete);
+      SessionsSubsystem->MultiplayerOnDestroySessionComplete = MoveTemp(SavedOnDestroySessionComplete);
+      SessionsSubsystem->MultiplayerOnFindSessionsComplete = MoveTemp(SavedOnFindSessionsComplete);
+      SessionsSubsystem->MultiplayerOnFindSessionsPage = MoveTemp(SavedOnFindSessionsPage);
+      SessionsSubsystem->MultiplayerOnJoinSessionComplete = MoveTemp(SavedOnJoinSessionComplete);
+    }
+
+    bool HasSession() const
+    {
+      const IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get();
+      const IOnlineSessionPtr SessionInterface = OnlineSubsystem ? OnlineSubsystem->GetSessionInterface() : nullptr;
+      return SessionInterface.IsValid() && SessionInterface->GetNamedSession(NAME_GameSession) != nullptr;
+    }
+  };
+
+  static FString DescribeStates(const TArray<EMultiplayerSessionState>& States)
+  {
+    FString Description;
+    for (EMultiplayerSessionState State : States)
+    {
+      if (!Description.IsEmpty())
+        Description += TEXT(" -> ");
+      Description += UEnum::GetValueAsString(State);
+    }
+    return Description;
+  }
+
+  static void TestStates(FAutomationTestBase& Test, const TCHAR* What, FSessionTestContext& Context, const TArray<EMultiplayerSessionState>& Expected)
+  {
+    if (Context.States != Expected)
+      Test.AddError(FString::Printf(TEXT("%s: went %s, expected %s"), What, *DescribeStates(Context.States), *DescribeStates(Expected)));
+
+    Context.States.Reset();
+  }
+}
+
+//
+// Waits until the subsystem settles in State, failing the test after TimeoutSeconds
+//
+class FWaitForSessionStateCommand : public IAutomationLatentCommand
+{
+public:
+  FWaitForSessionStateCommand(FAutomationTestBase* InTest, TSharedRef<MultiplayerSessionsTests::FSessionTestContext> InContext, EMultiplayerSessionState InState, float InTimeoutSeconds = 10.f)
+    : Test(InTest)
+    , Context(InContext)
+    , State(InState)
+    , TimeoutSeconds(InTimeoutSeconds)
+  {
+  }
+
+  virtual bool Update() override
+  {
+    const UMultiplayerSessionsSubsystem* SessionsSubsystem = Context->Subsystem.Get();
+    if (!SessionsSubsystem)
+      return true;
+
+    if (SessionsSubsystem->GetSessionState() == State)
+      return true;
+
+    if (GetCurrentRunTime() > TimeoutSeconds)
+    {
+      Test->AddError(FString::Printf(TEXT("Timed out waiting for %s, still %s"),
+        *UEnum::GetValueAsString(State), *UEnum::GetValueAsString(SessionsSubsystem->GetSessionState())));
+      return true;
+    }
+
+    return false;
+  }
+
+private:
+  FAutomationTestBase* Test;
+  TSharedRef<MultiplayerSessionsTests::FSessionTestContext> Context;
+  EMultiplayerSessionState State;
+  float TimeoutSeconds;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMultiplayerSessionsRehostTest, "MultiplayerSessions.StateMachine.Rehost",
+  EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FMultiplayerSessionsRehostTest::RunTest(const FString& Parameters)
+{
+  using namespace MultiplayerSessionsTests;
+
+  TSharedRef<FSessionTestContext> Context = MakeShared<FSessionTestContext>();
+  if (!Context->Begin(*this))
+    return false;
+
+  // Whatever the game was hosting goes first
+  Context->Subsystem->DestroySession();
+  ADD_LATENT_AUTOMATION_COMMAND(FWaitForSessionStateCommand(this, Context, EMultiplayerSessionState::Idle));
+
+  ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Context]()
+  {
+    TestFalse(TEXT("No session before hosting"), Context->HasSession());
+    Context->States.Reset();
+
+    Context->Subsystem->CreateSession(4, TestMatchType);
+    return true;
+  }));
+  ADD_LATENT_AUTOMATION_COMMAND(FWaitForSessionStateCommand(this, Context, EMultiplayerSessionState::InSession));
+
+  ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Context]()
+  {
+    TestStates(*this, TEXT("Host"), *Context, { EMultiplayerSessionState::Creating, EMultiplayerSessionState::Starting, EMultiplayerSessionState::InSession });
+    TestTrue(TEXT("Session exists after hosting"), Context->HasSession());
+
+    Context->Subsystem->DestroySession();
+    return true;
+  }));
+  ADD_LATENT_AUTOMATION_COMMAND(FWaitForSessionStateCommand(this, Context, EMultiplayerSessionState::Idle));
+
+  ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Context]()
+  {
+    TestStates(*this, TEXT("Destroy"), *Context, { EMultiplayerSessionState::Destroying, EMultiplayerSessionState::Idle });
+    TestFalse(TEXT("No session after destroying"), Context->HasSession());
+
+    Context->Subsystem->CreateSession(4, TestMatchType);
+    return true;
+  }));
+  ADD_LATENT_AUTOMATION_COMMAND(FWaitForSessionStateCommand(this, Context, EMultiplayerSessionState::InSession));
+
+  ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Context]()
+  {
+    TestStates(*this, TEXT("Host again"), *Context, { EMultiplayerSessionState::Creating, EMultiplayerSessionState::Starting, EMultiplayerSessionState::InSession });
+
+    // Re-hosting on top of a live session destroys it first, a second request waits for the first to finish
+    Context->Subsystem->CreateSession(4, TestMatchType);
+    Context->Subsystem->CreateSession(4, TestMatchType);
+    return true;
+  }));
+  ADD_LATENT_AUTOMATION_COMMAND(FWaitForSessionStateCommand(this, Context, EMultiplayerSessionState::InSession));
+
+  ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Context]()
+  {
+    TestStates(*this, TEXT("Rehost"), *Context, {
+      EMultiplayerSessionState::Destroying, EMultiplayerSessionState::Idle,
+      EMultiplayerSessionState::Creating, EMultiplayerSessionState::Starting, EMultiplayerSessionState::InSession,
+      EMultiplayerSessionState::Destroying, EMultiplayerSessionState::Idle,
+      EMultiplayerSessionState::Creating, EMultiplayerSessionState::Starting, EMultiplayerSessionState::InSession });
+    TestTrue(TEXT("Session exists after re-hosting"), Context->HasSession());
+
+    Context->Subsystem->DestroySession();
+    return true;
+  }));
+  ADD_LATENT_AUTOMATION_COMMAND(FWaitForSessionStateCommand(this, Context, EMultiplayerSessionState::Idle));
+
+  ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([Context]()
+  {
+    Context->End();
+    return true;
+  }));
+
+  return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMultiplayerSessionsCancelFindTest, "MultiplayerSessions.StateMachine.CancelFind",
+  EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FMultiplayerSessionsCancelFindTest::RunTest(const FString& Parameters)
+{
+  using namespace MultiplayerSessionsTests;
+
+  TSharedRef<FSessionTestContext> Context = MakeShared<FSessionTestContext>();
+  if (!Context->Begin(*this))
+    return false;
+
+  // A LAN search on the NULL subsystem only completes when its timeout runs out, long enough to cancel it
+  FMultiplayerSessionSearchParams Params;
+  Params.MatchType = TestMatchType;
+  Params.TimeoutSeconds = 2.f;
+
+  Context->Subsystem->FindSessions(Params);
+  TestTrue(TEXT("Searching after FindSessions"), Context->Subsystem->IsSearching());
+
+  Context->Subsystem->CancelFindSessions();
+  TestFalse(TEXT("Not searching after CancelFindSessions"), Context->Subsystem->IsSearching());
+
+  // Nothing of the cancelled search may come through, not even once the online search would have ended
+  ADD_LATENT_AUTOMATION_COMMAND(FWaitLatentCommand(Params.TimeoutSeconds + 1.f));
+
+  ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Context, Params]()
+  {
+    TestEqual(TEXT("No completion from the cancelled search"), Context->NumFindCompletes, 0);
+    TestEqual(TEXT("No pages from the cancelled search"), Context->NumFindPages, 0);
+    TestFalse(TEXT("Still not searching"), Context->Subsystem->IsSearching());
+    TestStates(*this, TEXT("Cancelled search"), *Context, {});
+
+    // The next search runs to completion as usual
+    Context->Subsystem->FindSessions(Params);
+    TestTrue(TEXT("Searching again"), Context->Subsystem->IsSearching());
+    return true;
+  }));
+
+  ADD_LATENT_AUTOMATION_COMMAND(FUntilCommand(
+    [Context]() { return Context->NumFindCompletes > 0; },
+    [this]() { AddError(TEXT("Timed out waiting for the search to complete")); return true; },
+    Params.TimeoutSeconds + 5.f));
+
+  ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Context]()
+  {
+    TestEqual(TEXT("The new search completes once"), Context->NumFindCompletes, 1);
+    TestFalse(TEXT("Not searching after completion"), Context->Subsystem->IsSearching());
+    TestStates(*this, TEXT("Search"), *Context, {});
+
+    Context->End();
+    return true;
+  }));
+
+  return true;
+}
+
+#endif
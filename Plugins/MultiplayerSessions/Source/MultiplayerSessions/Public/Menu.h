@@ -8,6 +8,8 @@
 #include "Blueprint/UserWidget.h"
 #include "Menu.generated.h"
 
+struct FMultiplayerSessionSearchParams;
+
 /**
  * 
  */
@@ -39,6 +41,8 @@ protected:
 
 	void OnFindSessions(const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccesfull);
 
+	void OnFindSessionsPage(TArrayView<const FOnlineSessionSearchResult> Page, bool bLastPage);
+
 	void OnJoinSession(EOnJoinSessionCompleteResult::Type Result);
 
 	UFUNCTION()
@@ -63,6 +67,8 @@ private:
 
 	void MenuTearDown();
 
+	FMultiplayerSessionSearchParams MakeSearchParams() const;
+
 	class UMultiplayerSessionsSubsystem * SessionsSubsystem;
 
 	int32 NumPublicConnections{4};
@@ -5,9 +5,23 @@
 #include "CoreMinimal.h"
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "Interfaces/OnlineSessionInterface.h"
+#include "Containers/Ticker.h"
 
 #include "MultiplayerSessionsSubsystem.generated.h"
 
+//
+// Where the hosted session is. Destroying, Creating and Starting wait on the online service and time out
+// after OperationTimeoutSeconds; requests made meanwhile are queued and run once it is back to Idle or InSession.
+//
+UENUM()
+enum class EMultiplayerSessionState : uint8
+{
+	Idle,
+	Destroying,
+	Creating,
+	Starting,
+	InSession
+};
 
 //
 // Declaring our own custom delegates for the Menu class to bind callbacks to
@@ -15,6 +29,9 @@
 
 DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnJoinSessionComplete, EOnJoinSessionCompleteResult::Type Result);
 DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnFindSessionsComplete, const TArray<FOnlineSessionSearchResult>& SessionResult, bool bWasSuccesfull);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnFindSessionsPage, TArrayView<const FOnlineSessionSearchResult> Page, bool bLastPage);
+DECLARE_MULTICAST_DELEGATE(FMultiplayerOnSessionCacheUpdated);
+DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnSessionStateChanged, EMultiplayerSessionState State);
 
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnCreateSessionComplete, FName, NewSessionName, bool, bWasSuccesfull);
@@ -22,25 +39,88 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnStartSessionComplete,
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnDestroySessionComplete, bool, bWasSuccesfull);
 
 
+//
+// What a session search asks for. MatchType and free slots go into the query so the online service
+// filters them, whatever it does not support is filtered out before any result reaches the caller.
+// Sessions of another build are never returned, see BuildUniqueId in CreateSession.
+//
+struct FMultiplayerSessionSearchParams
+{
+	FString MatchType;
+	int32 MaxSearchResults = 100;
+	int32 MinFreeSlots = 1;
+
+	// Results are handed out this many at a time, one page per frame
+	int32 PageSize = 10;
+
+	// The search is cancelled after this long and whatever was found so far is delivered
+	float TimeoutSeconds = 10.f;
+};
+
+//
+// A session seen by a search. While browsing the cache is refreshed in the background, entries that
+// stop showing up are dropped after CacheMaxAgeSeconds.
+//
+struct FMultiplayerCachedSession
+{
+	FOnlineSessionSearchResult Result;
+	double LastSeenTime = 0.0;
+};
+
+//
+// A queued CreateSession, DestroySession or StartSession call
+//
+struct FMultiplayerSessionOp
+{
+	enum class EType : uint8
+	{
+		Create,
+		Destroy,
+		Start
+	};
+
+	EType Type = EType::Create;
+	int32 NumPublicConnections = 0;
+	FString MatchType;
+};
+
 /**
  * 
  */
-UCLASS()
+UCLASS(Config = Game)
 class MULTIPLAYERSESSIONS_API UMultiplayerSessionsSubsystem : public UGameInstanceSubsystem
 {
 	GENERATED_BODY()
 public:
 	UMultiplayerSessionsSubsystem();
 
+	virtual void Deinitialize() override;
+
 	//
 	// To handle session functionality. The menu class will call this
 	//
 
 	void CreateSession(int32 NumPublicConnections, FString MatchType);
-	void FindSessions(int32 MaxSearchResults);
+	void FindSessions(const FMultiplayerSessionSearchParams& Params);
+	void CancelFindSessions();
+	FORCEINLINE bool IsSearching() const { return bSearching; }
 	void JoinSession(const FOnlineSessionSearchResult& SessionResult);
+
+	// Joins the best result of the last search, falling back to the next best when a join fails
+	void JoinBestSession();
+
+	// Joins the best cached session matching Params right away, while a fresh search validates the cache.
+	// False when nothing cached matches, the caller should search instead.
+	bool JoinCachedSession(const FMultiplayerSessionSearchParams& Params);
+
+	// Refreshes the session cache every RefreshIntervalSeconds until StopBrowsing, e.g. while a menu is open
+	void StartBrowsing(const FMultiplayerSessionSearchParams& Params);
+	void StopBrowsing();
+	FORCEINLINE bool IsBrowsing() const { return bBrowsing; }
+	FORCEINLINE const TMap<FString, FMultiplayerCachedSession>& GetSessionCache() const { return SessionCache; }
 	void DestroySession();
 	void StartSession();
+	FORCEINLINE EMultiplayerSessionState GetSessionState() const { return SessionState; }
 
 	//
 	// Our own custom delegates for the menu class to bind callbacks to
@@ -49,6 +129,9 @@ public:
 	FMultiplayerOnCreateSessionComplete  MultiplayerOnCreateSessionComplete;
 	FMultiplayerOnJoinSessionComplete    MultiplayerOnJoinSessionComplete;
 	FMultiplayerOnFindSessionsComplete   MultiplayerOnFindSessionsComplete;
+	FMultiplayerOnFindSessionsPage       MultiplayerOnFindSessionsPage;
+	FMultiplayerOnSessionCacheUpdated    MultiplayerOnSessionCacheUpdated;
+	FMultiplayerOnSessionStateChanged    MultiplayerOnSessionStateChanged;
 	FMultiplayerOnStartSessionComplete   MultiplayerOnStartSessionComplete;
 	FMultiplayerOnDestroySessionComplete MultiplayerOnDestroySessionComplete;
 
@@ -67,10 +150,62 @@ protected:
 	void OnStartSessionComplete(FName SessionName, bool bIsWasSuccesfull);
 
 private:
+	//
+	// Host state machine, every CreateSession, DestroySession and StartSession goes through the op queue
+	//
+
+	void QueueOp(const FMultiplayerSessionOp& Op);
+	void PumpOps();
+	void BeginCreateSession();
+	void BeginDestroySession();
+	void BeginStartSession();
+	void SetSessionState(EMultiplayerSessionState NewState);
+	bool IsSessionBusy() const;
+	bool OnOperationTimeout(float DeltaTime);
+
+	bool StartSearch(const FMultiplayerSessionSearchParams& Params);
+	void ProcessSearchResults();
+	void FilterSearchResults();
+	bool MatchesSearchParams(const FOnlineSessionSearchResult& Result, const FMultiplayerSessionSearchParams& Params) const;
+	bool DeliverNextPage(float DeltaTime);
+	bool OnSearchTimeout(float DeltaTime);
+	void FinishSearch(bool bWasSuccesfull);
+
+	//
+	// Best server selection, results are ranked by score before they are paged out
+	//
+
+	float ScoreSession(const FOnlineSessionSearchResult& Result) const;
+	void RankSessions(TArray<FOnlineSessionSearchResult>& Results) const;
+	void ApplyPingCutoff(TArray<FOnlineSessionSearchResult>& Results) const;
+	void ProbeCandidates();
+	void OnProbeComplete(int32 Generation, int32 ResultIndex, bool bSuccess, float PingMs);
+	bool OnProbeTimeout(float DeltaTime);
+	void DeliverResults();
+	void StartJoinCandidates();
+	bool JoinNextCandidate();
+	bool StartJoin(const FOnlineSessionSearchResult& SessionResult);
+
+	//
+	// Session cache
+	//
+
+	bool OnRefreshTick(float DeltaTime);
+	void RefreshSessionCache(const FMultiplayerSessionSearchParams& Params);
+	void UpdateSessionCache();
+	void FinishRefresh();
+	void PruneJoinCandidates();
+
 	IOnlineSessionPtr SessionInterface;
 
 	TSharedPtr<FOnlineSessionSearch> SessionSearch;
 
+	FMultiplayerSessionSearchParams SearchParams;
+	bool bSearching{ false };
+	int32 NextPageIndex{ 0 };
+	FTSTicker::FDelegateHandle PageTickerHandle;
+	FTSTicker::FDelegateHandle SearchTimeoutHandle;
+
 	TSharedPtr<FOnlineSessionSettings> SessionSettings;
 	
 	//
@@ -92,8 +227,63 @@ private:
 	FOnStartSessionCompleteDelegate   StartSessionCompleteDelegate;
 	FDelegateHandle StartSessionCompleteDelegateHandle;
 
-	bool bCreateSessionOnDestroy{ false };
+	// Score = FreeSlotWeight * free slots + PopulationWeight * players - PingWeight * ping in ms
+	UPROPERTY(Config)
+	float PingWeight{ 1.f };
+
+	UPROPERTY(Config)
+	float FreeSlotWeight{ 10.f };
+
+	UPROPERTY(Config)
+	float PopulationWeight{ 5.f };
+
+	// Sessions measured slower than this after probing are never joined, ones without a measured ping are kept.
+	// 0 disables the cutoff
+	UPROPERTY(Config)
+	int32 MaxPingMs{ 0 };
+
+	// The best ranked candidates get their ping measured directly, in parallel, before ranking again
+	UPROPERTY(Config)
+	int32 NumProbeCandidates{ 0 };
+
+	UPROPERTY(Config)
+	float ProbeTimeoutSeconds{ 1.f };
+
+	UPROPERTY(Config)
+	int32 MaxJoinAttempts{ 3 };
+
+	int32 ProbeGeneration{ 0 };
+	int32 NumProbesPending{ 0 };
+	FTSTicker::FDelegateHandle ProbeTimeoutHandle;
+
+	// Ranked best first, taken from the last search or the cache when a join starts
+	TArray<FOnlineSessionSearchResult> JoinCandidates;
+	int32 JoinCandidateIndex{ 0 };
+	int32 NumJoinAttempts{ 0 };
+	bool bJoiningBest{ false };
+
+	UPROPERTY(Config)
+	float RefreshIntervalSeconds{ 15.f };
+
+	UPROPERTY(Config)
+	float CacheMaxAgeSeconds{ 45.f };
+
+	TMap<FString, FMultiplayerCachedSession> SessionCache;
+	FMultiplayerSessionSearchParams BrowseParams;
+	bool bBrowsing{ false };
+
+	// The running search is a background refresh, its results only go to the cache
+	bool bRefreshing{ false };
+	FTSTicker::FDelegateHandle RefreshTickerHandle;
+
+	UPROPERTY(Config)
+	float OperationTimeoutSeconds{ 10.f };
+
+	EMultiplayerSessionState SessionState{ EMultiplayerSessionState::Idle };
+	TArray<FMultiplayerSessionOp> PendingOps;
 
-	int32 LastNumPublicConnections;
-	FString LastMatchType;
+	// The op being worked on while the state is Destroying, Creating or Starting
+	FMultiplayerSessionOp CurrentOp;
+	FTSTicker::FDelegateHandle OperationTimeoutHandle;
+	bool bPumpingOps{ false };
 };
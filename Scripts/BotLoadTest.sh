@@ -0,0 +1,85 @@
+#!/usr/bin/env bash
+#
+# Starts a dedicated server and NUM_BOTS headless bot clients on this machine, lets them play for
+# DURATION seconds and writes the server's frame time, net tick time and bandwidth samples, in total
+# and per connection, to a CSV.
+#
+# Usage: Scripts/BotLoadTest.sh [NUM_BOTS] [DURATION] [MAP]
+#
+# UE_ROOT has to point at the engine install. SERVER_BOTS adds AI bots on the server on top of the
+# client bots, which is cheaper than processes but skips the client side of the netcode.
+# SERVER_ARGS is passed on to the server, e.g. to compare two settings of the same run:
+#   SERVER_ARGS="-ini:Game:[/Script/Blaster.BlasterTickSubsystem]:bThrottleServerPoses=False"
+
+set -euo pipefail
+
+NUM_BOTS=${1:-100}
+DURATION=${2:-300}
+MAP=${3:-/Game/Maps/GameStartupMap}
+SERVER_BOTS=${SERVER_BOTS:-0}
+PORT=${PORT:-7777}
+STATS_INTERVAL=${STATS_INTERVAL:-1}
+SPAWN_DELAY=${SPAWN_DELAY:-0.2}
+read -r -a EXTRA_SERVER_ARGS <<< "${SERVER_ARGS:-}"
+
+: "${UE_ROOT:?UE_ROOT must point at the Unreal Engine install}"
+
+PROJECT_DIR=$(cd "$(dirname "$0")/.." && pwd)
+PROJECT="$PROJECT_DIR/Blaster.uproject"
+EDITOR="$UE_ROOT/Engine/Binaries/Linux/UnrealEditor-Cmd"
+OUT_DIR=${OUT_DIR:-"$PROJECT_DIR/Saved/LoadTest/$(date +%Y%m%d-%H%M%S)"}
+
+mkdir -p "$OUT_DIR"
+
+# Steam is replaced by the NULL online subsystem, the game net driver then falls back to the IP driver
+COMMON_ARGS=(-nullrhi -nosound -unattended -nosplash -nosteam
+	-ini:Engine:[OnlineSubsystem]:DefaultPlatformService=Null)
+
+PIDS=()
+cleanup()
+{
+	for PID in "${PIDS[@]}"; do
+		kill "$PID" 2>/dev/null || true
+	done
+	wait 2>/dev/null || true
+}
+trap cleanup EXIT
+
+echo "Starting dedicated server on port $PORT ($MAP)"
+"$EDITOR" "$PROJECT" "$MAP?MaxPlayers=$((NUM_BOTS + SERVER_BOTS))" -server -port="$PORT" \
+	"${COMMON_ARGS[@]}" -BlasterStatsInterval="$STATS_INTERVAL" -BlasterServerBots="$SERVER_BOTS" \
+	${EXTRA_SERVER_ARGS[@]+"${EXTRA_SERVER_ARGS[@]}"} -log -abslog="$OUT_DIR/Server.log" > /dev/null 2>&1 &
+PIDS+=($!)
+
+# Give the server time to load the map before the clients knock
+sleep "${SERVER_STARTUP:-20}"
+
+echo "Starting $NUM_BOTS bot clients"
+for ((BOT = 0; BOT < NUM_BOTS; ++BOT)); do
+	"$EDITOR" "$PROJECT" "127.0.0.1:$PORT" -game "${COMMON_ARGS[@]}" -BlasterBot \
+		-log -abslog="$OUT_DIR/Bot$BOT.log" > /dev/null 2>&1 &
+	PIDS+=($!)
+	sleep "$SPAWN_DELAY"
+done
+
+echo "Running for $DURATION seconds, logs in $OUT_DIR"
+sleep "$DURATION"
+
+CSV="$OUT_DIR/ServerStats.csv"
+SAMPLES=$(grep -o 'LoadTest: .*' "$OUT_DIR/Server.log" | sed 's/^LoadTest: //' || true)
+if [[ -z "$SAMPLES" ]]; then
+	echo "No LoadTest samples in $OUT_DIR/Server.log"
+	exit 1
+fi
+
+# Samples are key=value pairs in a fixed order, the keys of the first one become the header
+head -n 1 <<< "$SAMPLES" | sed -E 's/=[^ ]*//g; s/ /,/g' > "$CSV"
+sed -E 's/[A-Za-z_]+=//g; s/ /,/g' <<< "$SAMPLES" >> "$CSV"
+
+# Columns: clients,bots,frame_avg_ms,frame_max_ms,net_dispatch_avg_ms,net_flush_avg_ms,net_max_ms,
+#          out_Bps,in_Bps,conn_out_avg_Bps,conn_in_avg_Bps,conn_out_max_Bps
+awk -F, 'NR > 1 { n++; frame += $3; if ($4 > peak) peak = $4; net += $5 + $6; if ($7 > net_peak) net_peak = $7
+		out += $8; in_ += $9; conn_out += $10; conn_in += $11; if ($12 > conn_peak) conn_peak = $12 }
+	END { if (n) printf "%d samples: frame avg %.2f ms, peak %.2f ms, net tick avg %.2f ms, peak %.2f ms, out %.0f B/s, in %.0f B/s, per connection out %.0f B/s, in %.0f B/s, busiest %.0f B/s\n",
+		n, frame / n, peak, net / n, net_peak, out / n, in_ / n, conn_out / n, conn_in / n, conn_peak }' "$CSV"
+echo "Wrote $CSV"
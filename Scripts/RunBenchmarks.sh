@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+#
+# Runs the Blaster benchmark commandlet headless and compares the results against a stored baseline.
+# Exits non-zero when a scenario regressed by more than THRESHOLD (fraction, default from DefaultGame.ini).
+#
+# Usage: Scripts/RunBenchmarks.sh [--update-baseline] [extra commandlet arguments]
+#
+# UE_ROOT has to point at the engine install. BASELINE defaults to Benchmarks/Baseline-<host>.json, timings
+# are only comparable on the same machine.
+
+set -euo pipefail
+
+: "${UE_ROOT:?UE_ROOT must point at the Unreal Engine install}"
+
+PROJECT_DIR=$(cd "$(dirname "$0")/.." && pwd)
+PROJECT="$PROJECT_DIR/Blaster.uproject"
+EDITOR="$UE_ROOT/Engine/Binaries/Linux/UnrealEditor-Cmd"
+BASELINE=${BASELINE:-"$PROJECT_DIR/Benchmarks/Baseline-$(hostname -s).json"}
+OUTPUT=${OUTPUT:-"$PROJECT_DIR/Saved/Benchmark/Results-$(date +%Y%m%d-%H%M%S).json"}
+
+UPDATE_BASELINE=0
+if [[ "${1:-}" == "--update-baseline" ]]; then
+	UPDATE_BASELINE=1
+	shift
+fi
+
+mkdir -p "$(dirname "$OUTPUT")"
+
+ARGS=(-run=BlasterBenchmark -nullrhi -nosound -unattended -nosplash -nosteam -Output="$OUTPUT")
+if [[ -n "${THRESHOLD:-}" ]]; then
+	ARGS+=(-Threshold="$THRESHOLD")
+fi
+if [[ $UPDATE_BASELINE -eq 0 && -f "$BASELINE" ]]; then
+	ARGS+=(-Baseline="$BASELINE")
+fi
+
+STATUS=0
+"$EDITOR" "$PROJECT" "${ARGS[@]}" "$@" || STATUS=$?
+
+if [[ $UPDATE_BASELINE -eq 1 && $STATUS -eq 0 ]]; then
+	mkdir -p "$(dirname "$BASELINE")"
+	cp "$OUTPUT" "$BASELINE"
+	echo "Baseline updated: $BASELINE"
+elif [[ ! -f "$BASELINE" ]]; then
+	echo "No baseline at $BASELINE, run with --update-baseline to create one"
+fi
+
+exit $STATUS
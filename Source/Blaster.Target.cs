@@ -11,5 +11,6 @@ public class BlasterTarget : TargetRules
 		DefaultBuildSettings = BuildSettingsVersion.V2;
 		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_1;
 		ExtraModuleNames.Add("Blaster");
+		bWithPushModel = true;
 	}
 }
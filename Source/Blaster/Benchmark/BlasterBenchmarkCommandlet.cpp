@@ -0,0 +1,494 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterBenchmarkCommandlet.h"
+#include "Blaster/Blaster.h"
+#include "Blaster/BlasterComponents/CombatComponent.h"
+#include "Blaster/BlasterSubsystems/BlasterPickupSubsystem.h"
+#include "Blaster/BlasterSubsystems/BlasterProjectileSubsystem.h"
+#include "Blaster/Character/BlasterAnimInstance.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/Weapon/Weapon.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Containers/Ticker.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "OnlineSessionSettings.h"
+#include "OnlineSubsystem.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+static constexpr float BenchmarkDeltaTime = 1.f / 30.f;
+
+static FBlasterBenchmarkResult MakeResult(const FString& Name, int32 Count, TArray<double>& Samples)
+{
+	FBlasterBenchmarkResult Result;
+	Result.Name = Name;
+	Result.Count = Count;
+	Result.NumSamples = Samples.Num();
+	if (Samples.Num() == 0)
+		return Result;
+
+	Samples.Sort();
+	Result.MedianMs = Samples[Samples.Num() / 2];
+	Result.P99Ms = Samples[FMath::Min(FMath::FloorToInt(Samples.Num() * 0.99), Samples.Num() - 1)];
+
+	UE_LOG(LogBlaster, Display, TEXT("%s (%d): median %.4f ms, p99 %.4f ms over %d iterations"), *Name, Count, Result.MedianMs, Result.P99Ms, Result.NumSamples);
+	return Result;
+}
+
+// Runs Body NumIterations times after a short warm up and reports the median and p99 duration
+template<typename BodyType>
+static FBlasterBenchmarkResult Measure(const FString& Name, int32 Count, int32 NumIterations, BodyType&& Body)
+{
+	const int32 NumWarmUp = FMath::Max(NumIterations / 10, 1);
+	for (int32 Iteration = 0; Iteration < NumWarmUp; ++Iteration)
+		Body();
+
+	TArray<double> Samples;
+	Samples.Reserve(NumIterations);
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		const double Start = FPlatformTime::Seconds();
+		Body();
+		Samples.Add((FPlatformTime::Seconds() - Start) * 1000.0);
+	}
+
+	return MakeResult(Name, Count, Samples);
+}
+
+// Ticks the core ticker, which drives the online subsystems, until bDone is set or the timeout runs out
+static bool PumpUntil(const bool& bDone, double TimeoutSeconds)
+{
+	const double EndTime = FPlatformTime::Seconds() + TimeoutSeconds;
+	while (!bDone && FPlatformTime::Seconds() < EndTime)
+	{
+		FTSTicker::GetCoreTicker().Tick(0.01f);
+		FPlatformProcess::Sleep(0.005f);
+	}
+
+	return bDone;
+}
+
+UBlasterBenchmarkCommandlet::UBlasterBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = true;
+	IsEditor = false;
+	LogToConsole = true;
+
+	DefaultCount = 100;
+	DefaultIterations = 200;
+	PickupWeaponCount = 500;
+	ProjectileCount = 10000;
+	SessionIterations = 3;
+	DefaultThreshold = 0.1;
+}
+
+int32 UBlasterBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString ScenarioList = TEXT("AimOffset,AnimGather,WeaponEquipDrop,WeaponPickup,Projectiles,Session");
+	FParse::Value(*Params, TEXT("Scenarios="), ScenarioList, false);
+
+	TArray<FString> Scenarios;
+	ScenarioList.ParseIntoArray(Scenarios, TEXT(","));
+
+	int32 Count = DefaultCount;
+	int32 NumIterations = DefaultIterations;
+	int32 NumPickupWeapons = PickupWeaponCount;
+	int32 NumProjectiles = ProjectileCount;
+	double Threshold = DefaultThreshold;
+	FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmark") / TEXT("Results.json");
+	FString BaselinePath;
+	FParse::Value(*Params, TEXT("Count="), Count);
+	FParse::Value(*Params, TEXT("Iterations="), NumIterations);
+	FParse::Value(*Params, TEXT("PickupWeapons="), NumPickupWeapons);
+	FParse::Value(*Params, TEXT("Projectiles="), NumProjectiles);
+	FParse::Value(*Params, TEXT("Threshold="), Threshold);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	FParse::Value(*Params, TEXT("Baseline="), BaselinePath);
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("BlasterBenchmark"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	SpawnCharacters(World, Count);
+	SpawnWeapons(World, Count);
+
+	TArray<FBlasterBenchmarkResult> Results;
+	for (const FString& Scenario : Scenarios)
+	{
+		if (Scenario == TEXT("AimOffset"))
+			Results.Add(RunAimOffset(NumIterations));
+		else if (Scenario == TEXT("AnimGather"))
+			Results.Add(RunAnimGather(NumIterations));
+		else if (Scenario == TEXT("WeaponEquipDrop"))
+			Results.Add(RunWeaponEquipDrop(NumIterations));
+		else if (Scenario == TEXT("WeaponPickup"))
+			Results.Add(RunWeaponPickup(World, NumIterations, NumPickupWeapons));
+		else if (Scenario == TEXT("Projectiles"))
+			Results.Add(RunProjectiles(World, NumIterations, NumProjectiles));
+		else if (Scenario == TEXT("Session"))
+			RunSession(SessionIterations, Results);
+		else
+			UE_LOG(LogBlaster, Warning, TEXT("Unknown benchmark scenario %s"), *Scenario);
+	}
+
+	Characters.Reset();
+	Weapons.Reset();
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	// Scenarios that could not run report no samples, they are left out of the file but still checked against the baseline
+	TArray<FBlasterBenchmarkResult> SampledResults = Results;
+	SampledResults.RemoveAll([](const FBlasterBenchmarkResult& Result) { return Result.NumSamples == 0; });
+
+	if (!WriteResults(OutputPath, SampledResults))
+		return 1;
+
+	if (!BaselinePath.IsEmpty() && !CheckBaseline(BaselinePath, Results, Threshold))
+		return 1;
+
+	return 0;
+}
+
+void UBlasterBenchmarkCommandlet::SpawnCharacters(UWorld* World, int32 Count)
+{
+	UClass* Class = CharacterClass.LoadSynchronous();
+	if (!Class)
+		Class = ABlasterCharacter::StaticClass();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// A loose grid so no two characters share a spot
+	const int32 Columns = FMath::Max(FMath::CeilToInt(FMath::Sqrt(static_cast<float>(Count))), 1);
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const FVector Location((Index % Columns) * 300.f, (Index / Columns) * 300.f, 100.f);
+		ABlasterCharacter* Character = World->SpawnActor<ABlasterCharacter>(Class, Location, FRotator::ZeroRotator, SpawnParams);
+		if (Character)
+			Characters.Add(Character);
+	}
+}
+
+void UBlasterBenchmarkCommandlet::SpawnWeapons(UWorld* World, int32 Count)
+{
+	UClass* Class = WeaponClass.LoadSynchronous();
+	if (!Class)
+		Class = AWeapon::StaticClass();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		AWeapon* Weapon = World->SpawnActor<AWeapon>(Class, FVector(Index * 100.f, -500.f, 0.f), FRotator::ZeroRotator, SpawnParams);
+		if (Weapon)
+			Weapons.Add(Weapon);
+	}
+}
+
+FBlasterBenchmarkResult UBlasterBenchmarkCommandlet::RunAimOffset(int32 NumIterations)
+{
+	// Holding a weapon takes AimOffset down its full path
+	for (int32 Index = 0; Index < Characters.Num() && Index < Weapons.Num(); ++Index)
+	{
+		if (Characters[Index]->Combat)
+			Characters[Index]->Combat->EquipWeapon(Weapons[Index]);
+	}
+
+	return Measure(TEXT("AimOffset"), Characters.Num(), NumIterations, [this]()
+	{
+		for (ABlasterCharacter* Character : Characters)
+			Character->AimOffset(BenchmarkDeltaTime);
+	});
+}
+
+FBlasterBenchmarkResult UBlasterBenchmarkCommandlet::RunAnimGather(int32 NumIterations)
+{
+	TArray<UBlasterAnimInstance*> AnimInstances;
+	for (ABlasterCharacter* Character : Characters)
+	{
+		UBlasterAnimInstance* AnimInstance = Character->GetMesh() ? Cast<UBlasterAnimInstance>(Character->GetMesh()->GetAnimInstance()) : nullptr;
+		if (AnimInstance)
+			AnimInstances.Add(AnimInstance);
+	}
+
+	if (AnimInstances.Num() == 0)
+	{
+		UE_LOG(LogBlaster, Warning, TEXT("AnimGather skipped, the character class has no Blaster anim instance"));
+		return FBlasterBenchmarkResult();
+	}
+
+	// Only the game thread half, the engine dispatches the thread safe half from the component tick
+	return Measure(TEXT("AnimGather"), AnimInstances.Num(), NumIterations, [&AnimInstances]()
+	{
+		for (UBlasterAnimInstance* AnimInstance : AnimInstances)
+			AnimInstance->NativeUpdateAnimation(BenchmarkDeltaTime);
+	});
+}
+
+FBlasterBenchmarkResult UBlasterBenchmarkCommandlet::RunWeaponEquipDrop(int32 NumIterations)
+{
+	const int32 Count = FMath::Min(Characters.Num(), Weapons.Num());
+
+	return Measure(TEXT("WeaponEquipDrop"), Count, NumIterations, [this, Count]()
+	{
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			if (Characters[Index]->Combat)
+				Characters[Index]->Combat->EquipWeapon(Weapons[Index]);
+		}
+
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			Weapons[Index]->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+			Weapons[Index]->SetWeaponState(EWeaponState::EWS_Dropped);
+		}
+	});
+}
+
+FBlasterBenchmarkResult UBlasterBenchmarkCommandlet::RunWeaponPickup(UWorld* World, int32 NumIterations, int32 NumWeapons)
+{
+	UBlasterPickupSubsystem* PickupGrid = World->GetSubsystem<UBlasterPickupSubsystem>();
+	if (!PickupGrid || !PickupGrid->IsGridEnabled())
+	{
+		UE_LOG(LogBlaster, Warning, TEXT("WeaponPickup skipped, the pickup grid is disabled"));
+		return FBlasterBenchmarkResult();
+	}
+
+	UClass* Class = WeaponClass.LoadSynchronous();
+	if (!Class)
+		Class = AWeapon::StaticClass();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// Spread over the area the characters stand in, so some are close enough to be picked up
+	const int32 Columns = FMath::Max(FMath::CeilToInt(FMath::Sqrt(static_cast<float>(Characters.Num()))), 1);
+	const float Extent = Columns * 300.f;
+	FRandomStream Random(42);
+
+	TArray<AWeapon*> PickupWeapons;
+	for (int32 Index = 0; Index < NumWeapons; ++Index)
+	{
+		const FVector Location(Random.FRandRange(0.f, Extent), Random.FRandRange(0.f, Extent), 100.f);
+		AWeapon* Weapon = World->SpawnActor<AWeapon>(Class, Location, FRotator::ZeroRotator, SpawnParams);
+		if (Weapon)
+			PickupWeapons.Add(Weapon);
+	}
+
+	UE_LOG(LogBlaster, Display, TEXT("WeaponPickup: %d characters, %d weapons"), Characters.Num(), PickupWeapons.Num());
+
+	FBlasterBenchmarkResult Result = Measure(TEXT("WeaponPickup"), PickupWeapons.Num(), NumIterations, [PickupGrid]()
+	{
+		PickupGrid->UpdateOverlappingWeapons();
+	});
+
+	for (AWeapon* Weapon : PickupWeapons)
+		Weapon->Destroy();
+
+	return Result;
+}
+
+FBlasterBenchmarkResult UBlasterBenchmarkCommandlet::RunProjectiles(UWorld* World, int32 NumIterations, int32 NumProjectiles)
+{
+	UBlasterProjectileSubsystem* Projectiles = World->GetSubsystem<UBlasterProjectileSubsystem>();
+	if (!Projectiles)
+	{
+		UE_LOG(LogBlaster, Warning, TEXT("Projectiles skipped, the projectile subsystem is not available"));
+		return FBlasterBenchmarkResult();
+	}
+
+	const int32 Count = FMath::Min(NumProjectiles, Projectiles->GetMaxProjectiles());
+	if (Count < NumProjectiles)
+		UE_LOG(LogBlaster, Warning, TEXT("Projectiles capped at MaxProjectiles (%d)"), Count);
+
+	// Long lived so only the shots that hit a character have to be replaced. Nothing but the characters is
+	// there to hit, the scene queries are far cheaper than against level geometry
+	FBlasterProjectileParams Params;
+	Params.Lifetime = 60.f;
+
+	FRandomStream Random(1337);
+	auto TopUp = [this, Projectiles, Count, &Params, &Random]()
+	{
+		while (Projectiles->GetNumProjectiles() < Count)
+		{
+			const FVector Center = Characters.Num() > 0 ? Characters[Random.RandHelper(Characters.Num())]->GetActorLocation() : FVector::ZeroVector;
+			const FVector Direction = FRotator(Random.FRandRange(-5.f, 5.f), Random.FRandRange(0.f, 360.f), 0.f).Vector();
+			Projectiles->SpawnProjectile(FBlasterProjectileSpawn::Make(Center + Direction * 100.f, Direction, Random.RandHelper(MAX_int32), 0.0), Params, nullptr);
+		}
+	};
+
+	TopUp();
+
+	FBlasterBenchmarkResult Result = Measure(TEXT("Projectiles"), Count, NumIterations, [Projectiles, &TopUp]()
+	{
+		Projectiles->Simulate(BenchmarkDeltaTime);
+		TopUp();
+	});
+
+	// Clear the remaining shots so later scenarios don't pay for them
+	Projectiles->Simulate(Params.Lifetime);
+	return Result;
+}
+
+void UBlasterBenchmarkCommandlet::RunSession(int32 NumIterations, TArray<FBlasterBenchmarkResult>& OutResults)
+{
+	IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get(FName(TEXT("NULL")));
+	IOnlineSessionPtr SessionInterface = OnlineSubsystem ? OnlineSubsystem->GetSessionInterface() : nullptr;
+	if (!SessionInterface.IsValid())
+	{
+		UE_LOG(LogBlaster, Warning, TEXT("Session skipped, the NULL online subsystem is not available"));
+		return;
+	}
+
+	FOnlineSessionSettings SessionSettings;
+	SessionSettings.bIsLANMatch = true;
+	SessionSettings.NumPublicConnections = 4;
+	SessionSettings.bShouldAdvertise = true;
+	SessionSettings.Set(FName("MatchType"), FString("FreeForAll"), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+
+	bool bCreated = false;
+	bool bFound = false;
+	bool bDestroyed = false;
+	const FDelegateHandle CreateHandle = SessionInterface->AddOnCreateSessionCompleteDelegate_Handle(
+		FOnCreateSessionCompleteDelegate::CreateLambda([&bCreated](FName, bool) { bCreated = true; }));
+	const FDelegateHandle FindHandle = SessionInterface->AddOnFindSessionsCompleteDelegate_Handle(
+		FOnFindSessionsCompleteDelegate::CreateLambda([&bFound](bool) { bFound = true; }));
+	const FDelegateHandle DestroyHandle = SessionInterface->AddOnDestroySessionCompleteDelegate_Handle(
+		FOnDestroySessionCompleteDelegate::CreateLambda([&bDestroyed](FName, bool) { bDestroyed = true; }));
+
+	// Each iteration is create, find, destroy; only the first two are timed
+	TArray<double> CreateSamples;
+	TArray<double> FindSamples;
+	for (int32 Iteration = 0; Iteration < NumIterations; ++Iteration)
+	{
+		bCreated = bFound = bDestroyed = false;
+
+		double Start = FPlatformTime::Seconds();
+		if (!SessionInterface->CreateSession(0, NAME_GameSession, SessionSettings) || !PumpUntil(bCreated, 10.0))
+			break;
+		CreateSamples.Add((FPlatformTime::Seconds() - Start) * 1000.0);
+
+		TSharedRef<FOnlineSessionSearch> SessionSearch = MakeShared<FOnlineSessionSearch>();
+		SessionSearch->bIsLanQuery = true;
+		SessionSearch->MaxSearchResults = 10;
+
+		Start = FPlatformTime::Seconds();
+		if (!SessionInterface->FindSessions(0, SessionSearch) || !PumpUntil(bFound, 30.0))
+			break;
+		FindSamples.Add((FPlatformTime::Seconds() - Start) * 1000.0);
+
+		SessionInterface->DestroySession(NAME_GameSession);
+		PumpUntil(bDestroyed, 10.0);
+	}
+
+	SessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateHandle);
+	SessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindHandle);
+	SessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroyHandle);
+
+	OutResults.Add(MakeResult(TEXT("SessionCreate"), 1, CreateSamples));
+	OutResults.Add(MakeResult(TEXT("SessionFind"), 1, FindSamples));
+}
+
+bool UBlasterBenchmarkCommandlet::WriteResults(const FString& Path, const TArray<FBlasterBenchmarkResult>& Results) const
+{
+	TArray<TSharedPtr<FJsonValue>> ScenarioValues;
+	for (const FBlasterBenchmarkResult& Result : Results)
+	{
+		TSharedRef<FJsonObject> Scenario = MakeShared<FJsonObject>();
+		Scenario->SetStringField(TEXT("name"), Result.Name);
+		Scenario->SetNumberField(TEXT("count"), Result.Count);
+		Scenario->SetNumberField(TEXT("samples"), Result.NumSamples);
+		Scenario->SetNumberField(TEXT("median_ms"), Result.MedianMs);
+		Scenario->SetNumberField(TEXT("p99_ms"), Result.P99Ms);
+		ScenarioValues.Add(MakeShared<FJsonValueObject>(Scenario));
+	}
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetArrayField(TEXT("scenarios"), ScenarioValues);
+
+	FString Json;
+	FJsonSerializer::Serialize(Root, TJsonWriterFactory<>::Create(&Json));
+	if (!FFileHelper::SaveStringToFile(Json, *Path))
+	{
+		UE_LOG(LogBlaster, Error, TEXT("Could not write benchmark results to %s"), *Path);
+		return false;
+	}
+
+	UE_LOG(LogBlaster, Display, TEXT("Benchmark results written to %s"), *Path);
+	return true;
+}
+
+bool UBlasterBenchmarkCommandlet::CheckBaseline(const FString& Path, const TArray<FBlasterBenchmarkResult>& Results, double Threshold) const
+{
+	FString Json;
+	TSharedPtr<FJsonObject> Root;
+	if (!FFileHelper::LoadFileToString(Json, *Path) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Root) || !Root.IsValid())
+	{
+		UE_LOG(LogBlaster, Error, TEXT("Could not read benchmark baseline %s"), *Path);
+		return false;
+	}
+
+	TMap<FString, TSharedPtr<FJsonObject>> Baseline;
+	const TArray<TSharedPtr<FJsonValue>>* ScenarioValues = nullptr;
+	if (Root->TryGetArrayField(TEXT("scenarios"), ScenarioValues))
+	{
+		for (const TSharedPtr<FJsonValue>& Value : *ScenarioValues)
+		{
+			const TSharedPtr<FJsonObject> Scenario = Value->AsObject();
+			if (Scenario.IsValid())
+				Baseline.Add(Scenario->GetStringField(TEXT("name")), Scenario);
+		}
+	}
+
+	for (const FBlasterBenchmarkResult& Result : Results)
+	{
+		if (!Baseline.Contains(Result.Name))
+			UE_LOG(LogBlaster, Warning, TEXT("%s has no baseline"), *Result.Name);
+	}
+
+	bool bPassed = true;
+	for (const TPair<FString, TSharedPtr<FJsonObject>>& Scenario : Baseline)
+	{
+		const FBlasterBenchmarkResult* Result = Results.FindByPredicate([&Scenario](const FBlasterBenchmarkResult& Candidate) { return Candidate.Name == Scenario.Key; });
+
+		// A scenario that stopped running or stopped measuring would otherwise pass silently
+		if (!Result || Result->NumSamples == 0)
+		{
+			UE_LOG(LogBlaster, Error, TEXT("%s is in the baseline but %s"), *Scenario.Key, Result ? TEXT("took no samples") : TEXT("did not run"));
+			bPassed = false;
+			continue;
+		}
+
+		// A different count measures a different workload, comparing it would be meaningless
+		if (static_cast<int32>(Scenario.Value->GetNumberField(TEXT("count"))) != Result->Count)
+		{
+			UE_LOG(LogBlaster, Warning, TEXT("%s baseline was taken with a different count, skipped"), *Result->Name);
+			continue;
+		}
+
+		const double BaselineMedian = Scenario.Value->GetNumberField(TEXT("median_ms"));
+		const double BaselineP99 = Scenario.Value->GetNumberField(TEXT("p99_ms"));
+		const bool bMedianRegressed = Result->MedianMs > BaselineMedian * (1.0 + Threshold);
+		const bool bP99Regressed = Result->P99Ms > BaselineP99 * (1.0 + Threshold);
+
+		if (bMedianRegressed || bP99Regressed)
+		{
+			UE_LOG(LogBlaster, Error, TEXT("%s regressed: median %.4f ms (baseline %.4f), p99 %.4f ms (baseline %.4f), threshold %.0f%%"),
+				*Result->Name, Result->MedianMs, BaselineMedian, Result->P99Ms, BaselineP99, Threshold * 100.0);
+			bPassed = false;
+		}
+	}
+
+	return bPassed;
+}
@@ -3,4 +3,9 @@
 #include "Blaster.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogBlaster);
+
+UE_TRACE_CHANNEL_DEFINE(BlasterCombatChannel);
+UE_TRACE_CHANNEL_DEFINE(BlasterCharacterChannel);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Blaster, "Blaster" );
@@ -3,4 +3,22 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 
+DECLARE_STATS_GROUP(TEXT("Blaster"), STATGROUP_Blaster, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("Blaster Combat"), STATGROUP_BlasterCombat, STATCAT_Advanced);
+DECLARE_STATS_GROUP(TEXT("Blaster Character"), STATGROUP_BlasterCharacter, STATCAT_Advanced);
+
+// Insights channels, enabled with -trace=cpu,BlasterCombat,BlasterCharacter
+UE_TRACE_CHANNEL_EXTERN(BlasterCombatChannel, BLASTER_API);
+UE_TRACE_CHANNEL_EXTERN(BlasterCharacterChannel, BLASTER_API);
+
+// Cycle stat and Insights scope in one
+#define BLASTER_SCOPE_CYCLE_COUNTER(Stat, Channel) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Stat, Channel)
+
+
+DECLARE_LOG_CATEGORY_EXTERN(LogBlaster, Log, All);
@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterBotComponent.h"
+#include "Blaster/Blaster.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/Weapon/Weapon.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Bot Tick"), STAT_BlasterBotTick, STATGROUP_Blaster);
+
+UBlasterBotComponent::UBlasterBotComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+
+	// Input has to be in before the pawn consumes it in its own tick
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+
+	DecisionInterval = 2.f;
+	WanderRadius = 3000.f;
+	AcceptanceRadius = 150.f;
+	TurnGain = 0.2f;
+	AimChance = 0.3f;
+	FireChance = 0.5f;
+
+	HomeLocation = FVector::ZeroVector;
+	TargetLocation = FVector::ZeroVector;
+	TargetPitch = 0.f;
+	StrafeValue = 0.f;
+	TimeToThink = 0.f;
+	bHasHome = false;
+	bWantsToAim = false;
+	bFirePressed = false;
+}
+
+void UBlasterBotComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	RandomStream.Initialize(GetUniqueID() ^ FPlatformProcess::GetCurrentProcessId());
+	TimeToThink = RandomStream.FRandRange(0.f, DecisionInterval);
+}
+
+void UBlasterBotComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	SCOPE_CYCLE_COUNTER(STAT_BlasterBotTick);
+
+	const AController* Controller = Cast<AController>(GetOwner());
+	ABlasterCharacter* BlasterCharacter = Controller ? Cast<ABlasterCharacter>(Controller->GetPawn()) : nullptr;
+	if (!BlasterCharacter)
+	{
+		bHasHome = false;
+		return;
+	}
+
+	if (!bHasHome)
+	{
+		HomeLocation = BlasterCharacter->GetActorLocation();
+		TargetLocation = HomeLocation;
+		bHasHome = true;
+	}
+
+	// A shot is a press on one frame and a release on the next
+	if (bFirePressed)
+	{
+		BlasterCharacter->FireBtnReleased();
+		bFirePressed = false;
+	}
+
+	TimeToThink -= DeltaTime;
+	if (TimeToThink <= 0.f || FVector::Dist2D(BlasterCharacter->GetActorLocation(), TargetLocation) < AcceptanceRadius)
+	{
+		Think(BlasterCharacter);
+		TimeToThink = DecisionInterval * RandomStream.FRandRange(0.75f, 1.25f);
+	}
+
+	Steer(BlasterCharacter, DeltaTime);
+}
+
+void UBlasterBotComponent::Think(ABlasterCharacter* BlasterCharacter)
+{
+	if (BlasterCharacter->GetOverlappingWeapon() && !BlasterCharacter->IsWeaponEquipped())
+		BlasterCharacter->EquipBtnPressed();
+
+	if (BlasterCharacter->IsWeaponEquipped() || !FindWeaponTarget(BlasterCharacter, TargetLocation))
+	{
+		const FVector2D Offset = FVector2D(RandomStream.VRand()).GetSafeNormal() * RandomStream.FRandRange(0.f, WanderRadius);
+		TargetLocation = HomeLocation + FVector(Offset, 0.f);
+	}
+
+	TargetPitch = RandomStream.FRandRange(-15.f, 15.f);
+	StrafeValue = RandomStream.FRandRange(-0.5f, 0.5f);
+
+	if (RandomStream.FRand() < AimChance)
+	{
+		bWantsToAim = !bWantsToAim;
+		if (bWantsToAim)
+			BlasterCharacter->AimBtnPressed();
+		else
+			BlasterCharacter->AimBtnReleased();
+	}
+
+	if (BlasterCharacter->IsWeaponEquipped() && RandomStream.FRand() < FireChance)
+	{
+		BlasterCharacter->FireBtnPressed();
+		bFirePressed = true;
+	}
+}
+
+void UBlasterBotComponent::Steer(ABlasterCharacter* BlasterCharacter, float DeltaTime)
+{
+	AController* Controller = BlasterCharacter->GetController();
+	const FRotator ControlRotation = Controller->GetControlRotation();
+	const FVector ToTarget = TargetLocation - BlasterCharacter->GetActorLocation();
+
+	const float YawError = FMath::FindDeltaAngleDegrees(ControlRotation.Yaw, ToTarget.Rotation().Yaw);
+	const float PitchError = FMath::FindDeltaAngleDegrees(ControlRotation.Pitch, TargetPitch);
+
+	if (Cast<APlayerController>(Controller))
+	{
+		BlasterCharacter->Turn(YawError * TurnGain);
+		BlasterCharacter->LookUp(-PitchError * TurnGain);
+	}
+	else
+	{
+		Controller->SetControlRotation(FRotator(ControlRotation.Pitch + PitchError * TurnGain, ControlRotation.Yaw + YawError * TurnGain, 0.f));
+	}
+
+	// Only walk once roughly facing the target, otherwise bots run in circles around it
+	if (FMath::Abs(YawError) < 60.f)
+		BlasterCharacter->MoveForward(1.f);
+
+	BlasterCharacter->MoveRight(StrafeValue);
+}
+
+bool UBlasterBotComponent::FindWeaponTarget(ABlasterCharacter* BlasterCharacter, FVector& OutLocation) const
+{
+	const FVector Location = BlasterCharacter->GetActorLocation();
+
+	float BestDistSquared = FMath::Square(WanderRadius);
+	bool bFound = false;
+	for (TActorIterator<AWeapon> It(GetWorld()); It; ++It)
+	{
+		if (It->IsHidden() || It->GetWeaponState() != EWeaponState::EWS_Initial)
+			continue;
+
+		const float DistSquared = FVector::DistSquared(Location, It->GetActorLocation());
+		if (DistSquared < BestDistSquared)
+		{
+			BestDistSquared = DistSquared;
+			OutLocation = It->GetActorLocation();
+			bFound = true;
+		}
+	}
+
+	return bFound;
+}
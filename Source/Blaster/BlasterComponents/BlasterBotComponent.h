@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "BlasterBotComponent.generated.h"
+
+class ABlasterCharacter;
+
+/**
+ * Plays the controlled ABlasterCharacter like a very simple player: wanders around, walks to weapons,
+ * picks them up, aims and fires. Added to a controller, either an ABlasterBotController on the server
+ * or the local player controller of a client started with -BlasterBot.
+ *
+ * Movement, equip, aim and fire go through the character's own input handlers, so bots exercise the
+ * same prediction and RPC paths as players. AI controllers have no player input to rotate with, they
+ * get their control rotation set directly instead of through Turn/LookUp.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class BLASTER_API UBlasterBotComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:	
+	UBlasterBotComponent();
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	void Think(ABlasterCharacter* BlasterCharacter);
+	void Steer(ABlasterCharacter* BlasterCharacter, float DeltaTime);
+	bool FindWeaponTarget(ABlasterCharacter* BlasterCharacter, FVector& OutLocation) const;
+
+	// Seconds between two decisions, each bot is offset randomly so they don't all think on the same frame
+	UPROPERTY(EditAnywhere, Category = "Bot")
+	float DecisionInterval;
+
+	UPROPERTY(EditAnywhere, Category = "Bot")
+	float WanderRadius;
+
+	// Close enough to the current target to pick a new one
+	UPROPERTY(EditAnywhere, Category = "Bot")
+	float AcceptanceRadius;
+
+	// Fraction of the remaining yaw/pitch error fed to Turn/LookUp per frame
+	UPROPERTY(EditAnywhere, Category = "Bot")
+	float TurnGain;
+
+	// Chance per decision to toggle aiming and to fire a shot with an equipped weapon
+	UPROPERTY(EditAnywhere, Category = "Bot")
+	float AimChance;
+
+	UPROPERTY(EditAnywhere, Category = "Bot")
+	float FireChance;
+
+	FRandomStream RandomStream;
+
+	FVector HomeLocation;
+	FVector TargetLocation;
+	float TargetPitch;
+	float StrafeValue;
+	float TimeToThink;
+	bool bHasHome;
+	bool bWantsToAim;
+	bool bFirePressed;
+};
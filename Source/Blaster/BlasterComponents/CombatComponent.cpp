@@ -3,18 +3,123 @@
 
 #include "CombatComponent.h"
 #include "Blaster/Weapon/Weapon.h"
+#include "Blaster/Weapon/ProjectileWeapon.h"
 #include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Engine/SkeletalMeshSocket.h"
 #include "Components/SphereComponent.h"
 #include <Net/UnrealNetwork.h>
-#include "GameFramework/CharacterMovementComponent.h"
+#include "Blaster/Character/BlasterCharacterMovementComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/DamageType.h"
+#include "Kismet/GameplayStatics.h"
+#include "Blaster/Blaster.h"
+#include "Blaster/BlasterSubsystems/BlasterTelemetrySubsystem.h"
+#include "Blaster/BlasterSubsystems/BlasterTickSubsystem.h"
+#include "Engine/ActorChannel.h"
+#include "Engine/GameInstance.h"
+#include "Engine/NetConnection.h"
+#include "EngineUtils.h"
+#include "TimerManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Push Compares Skipped (Combat)"), STAT_BlasterPushSkippedCombat, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Predicted Actions Pending"), STAT_BlasterPredictedActionsPending, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Predicted Equips Rolled Back"), STAT_BlasterPredictedEquipsRolledBack, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Input RPCs Sent"), STAT_BlasterInputRpcsSent, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Input Frames Deduplicated"), STAT_BlasterInputFramesDeduplicated, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Reliable Server RPCs"), STAT_BlasterReliableServerRpcs, STATGROUP_Blaster);
+DECLARE_CYCLE_STAT(TEXT("Combat Input"), STAT_BlasterCombatInput, STATGROUP_BlasterCombat);
+DECLARE_CYCLE_STAT(TEXT("Combat Ack"), STAT_BlasterCombatAck, STATGROUP_BlasterCombat);
+DECLARE_CYCLE_STAT(TEXT("Crosshair Trace"), STAT_BlasterCrosshairTrace, STATGROUP_BlasterCombat);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Crosshair Trace Latency (ms)"), STAT_BlasterCrosshairTraceLatency, STATGROUP_BlasterCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Crosshair Sync Fallbacks"), STAT_BlasterCrosshairSyncFallbacks, STATGROUP_BlasterCombat);
+DECLARE_CYCLE_STAT(TEXT("Score Request"), STAT_BlasterScoreRequest, STATGROUP_BlasterCombat);
+
+// True when sequence A was issued after B, robust to the 16 bit wrap around
+static bool IsSequenceNewer(uint16 A, uint16 B)
+{
+	return static_cast<int16>(A - B) > 0;
+}
+
+static void DumpCombatNet(UWorld* World)
+{
+	if (!World)
+		return;
+
+	for (TActorIterator<ABlasterCharacter> It(World); It; ++It)
+	{
+		UCombatComponent* Combat = It->FindComponentByClass<UCombatComponent>();
+		if (!Combat || !It->GetNetConnection())
+			continue;
+
+		// Each side only sees its own outgoing reliable bunches, the server RPC backlog is the owning client's
+		const TCHAR* BufferDirection = World->GetNetMode() == NM_Client ? TEXT("to server") : TEXT("to client");
+
+		int32 NumReliable = 0;
+		const float RpcRate = Combat->ConsumeServerRpcRate(NumReliable);
+		UE_LOG(LogBlaster, Display, TEXT("%s: %.1f server RPCs/s (%d reliable), reliable buffer %s %d/%d"),
+			*It->GetName(), RpcRate, NumReliable, BufferDirection, Combat->GetReliableBufferOccupancy(), RELIABLE_BUFFER);
+	}
+}
+
+static FAutoConsoleCommandWithWorld DumpCombatNetCommand(
+	TEXT("Blaster.DumpCombatNet"),
+	TEXT("Logs server RPC rate since the last dump and outgoing reliable buffer occupancy per connection. Run on the owning client for the server RPC backlog"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&DumpCombatNet));
+
+bool FBlasterInputPacket::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar << LastSequence;
+
+	uint32 Count = NumFrames;
+	Ar.SerializeInt(Count, MaxFrames + 1);
+	NumFrames = static_cast<uint8>(Count);
+
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames; ++FrameIndex)
+	{
+		uint32 FrameButtons = Buttons[FrameIndex];
+		Ar.SerializeBits(&FrameButtons, InputButton_NumBits);
+		Buttons[FrameIndex] = static_cast<uint8>(FrameButtons);
+	}
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
 
 UCombatComponent::UCombatComponent()
 {
 	PrimaryComponentTick.bCanEverTick = false;
 	BaseWalkSpeed = 600.f;
 	AimWalkSpeed = 300.f;
+	MaxTraceStartDistance = 1000.f;
+	FireIntervalTolerance = 0.05f;
+	MaxHitTimeAhead = 0.05f;
+	MaxRewindSlack = 0.1f;
+	LastScoreRequestTime = -UE_BIG_NUMBER;
+	LastServerFireTime = -UE_BIG_NUMBER;
+
+	LastAckedSequence = 0;
+	PendingHead = 0;
+	NumPendingActions = 0;
+	NextSequence = 0;
+
+	InputSequence = 0;
+	LastInputButtons = 0;
+	NumInputHistory = 0;
+	LastInputSendTime = 0.0;
+	LastInputSequence = 0;
+	MinInputSendInterval = 1.f / 30.f;
+	InputResendInterval = 0.1f;
+
+	NumServerRpcs = 0;
+	NumReliableServerRpcs = 0;
+	ServerRpcWindowStart = 0.0;
+
+	CrosshairHitFrame = 0;
+	FMemory::Memzero(CrosshairTraceIssueTimes);
+	NumCrosshairTracesIssued = 0;
+	CrosshairTraceDelegate.BindUObject(this, &UCombatComponent::OnCrosshairTraceDone);
 }
 
 void UCombatComponent::EquipWeapon(AWeapon* WeaponToEquip)
@@ -22,18 +127,103 @@ void UCombatComponent::EquipWeapon(AWeapon* WeaponToEquip)
 	if (!Character || !WeaponToEquip)
 		return;
 
+	if (EquippedWeapon && EquippedWeapon != WeaponToEquip)
+		DropWeapon();
+
 	EquippedWeapon = WeaponToEquip;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UCombatComponent, EquippedWeapon, this);
+	PushModelTracker.MarkDirty(PushProperty_EquippedWeapon);
 	EquippedWeapon->SetWeaponState(EWeaponState::EWS_Equipped);
 
+	AttachEquippedWeapon();
+
+	EquippedWeapon->SetOwner(Character);
+	ABlasterCharacter::NotifyEquipWeapon.Broadcast(Character, EquippedWeapon);
+
+	RefreshCombatAck();
+}
+
+void UCombatComponent::DropWeapon()
+{
+	if (!Character || !EquippedWeapon || !GetOwner()->HasAuthority())
+		return;
+
+	AWeapon* DroppedWeapon = EquippedWeapon;
+	EquippedWeapon = nullptr;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UCombatComponent, EquippedWeapon, this);
+	PushModelTracker.MarkDirty(PushProperty_EquippedWeapon);
+
+	DroppedWeapon->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	DroppedWeapon->SetOwner(nullptr);
+
+	// Back into the grid before the state change puts it to sleep
+	ABlasterCharacter::NotifyUnEquipWeapon.Broadcast(Character, DroppedWeapon);
+	DroppedWeapon->SetWeaponState(EWeaponState::EWS_Dropped);
+
+	ApplyEquippedOrientation();
+	RefreshCombatAck();
+}
+
+void UCombatComponent::PredictEquipWeapon(AWeapon* WeaponToEquip)
+{
+	const FBlasterPredictedAction* Action = ApplyPredictedEquip(WeaponToEquip);
+	if (!Action)
+		return;
+
+	ServerEquipWeapon(Action->Sequence);
+	CountServerRpc(EBlasterTelemetryRpc::EquipWeapon, true);
+}
+
+const FBlasterPredictedAction* UCombatComponent::ApplyPredictedEquip(AWeapon* WeaponToEquip)
+{
+	if (!Character || !WeaponToEquip)
+		return nullptr;
+
+	FBlasterPredictedAction& Action = PushPendingAction(EBlasterPredictedActionType::Equip);
+	Action.Weapon = WeaponToEquip;
+	Action.WeaponTransform = WeaponToEquip->GetActorTransform();
+
+	EquippedWeapon = WeaponToEquip;
+	EquippedWeapon->ShowPickupWidget(false);
+	AttachEquippedWeapon();
+
+	return &Action;
+}
+
+void UCombatComponent::ServerEquipWeapon_Implementation(uint16 Sequence)
+{
+	CountServerRpc(EBlasterTelemetryRpc::EquipWeapon, true);
+	LastAckedSequence = Sequence;
+
+	// The server's own overlap decides, a stale client guess simply gets corrected by the ack
+	AWeapon* WeaponToEquip = Character ? Character->GetOverlappingWeapon() : nullptr;
+	if (WeaponToEquip && WeaponToEquip->GetWeaponState() != EWeaponState::EWS_Equipped)
+		EquipWeapon(WeaponToEquip);
+	else
+		RefreshCombatAck();
+}
+
+void UCombatComponent::AttachEquippedWeapon()
+{
+	if (!Character || !EquippedWeapon)
+		return;
+
 	const USkeletalMeshSocket* HandSocket = Character->GetMesh()->GetSocketByName(FName("RightHandSocket"));
 
 	if (HandSocket)
 		HandSocket->AttachActor(EquippedWeapon, Character->GetMesh());
 
-	EquippedWeapon->SetOwner(Character);
+	ApplyEquippedOrientation();
+}
 
-	Character->GetCharacterMovement()->bOrientRotationToMovement = false;
-	Character->bUseControllerRotationYaw = true;
+void UCombatComponent::ApplyEquippedOrientation()
+{
+	if (!Character)
+		return;
+
+	// Armed characters face where they aim, unarmed ones where they run
+	Character->GetCharacterMovement()->bOrientRotationToMovement = EquippedWeapon == nullptr;
+	Character->bUseControllerRotationYaw = EquippedWeapon != nullptr;
 }
 
 void UCombatComponent::BeginPlay()
@@ -43,32 +233,489 @@ void UCombatComponent::BeginPlay()
 	if (Character)
 	{
 		Character->GetCharacterMovement()->MaxWalkSpeed = BaseWalkSpeed;
+
+		UBlasterCharacterMovementComponent* BlasterMovement = Cast<UBlasterCharacterMovementComponent>(Character->GetCharacterMovement());
+		if (BlasterMovement)
+			BlasterMovement->MaxWalkSpeedAiming = AimWalkSpeed;
 	}
 }
 
 void UCombatComponent::SetAiming(bool IsAiming)
 {
-	bIsAiming = IsAiming;
-  ServerSetAiming(IsAiming);
+	if (GetOwner() && GetOwner()->HasAuthority())
+	{
+		ApplyAiming(IsAiming);
+		RefreshCombatAck();
+		return;
+	}
 
-	if (Character)
-		Character->GetCharacterMovement()->MaxWalkSpeed = bIsAiming ? AimWalkSpeed : BaseWalkSpeed;
+	ApplyAiming(IsAiming);
+	RecordInputFrame();
+}
+
+void UCombatComponent::RecordInputFrame()
+{
+	const uint8 Buttons = (bIsAiming ? InputButton_Aim : 0) | (bFireButtonPressed ? InputButton_Fire : 0);
+	if (Buttons == LastInputButtons)
+		return;
+
+	LastInputButtons = Buttons;
+	++InputSequence;
+
+	if (NumInputHistory == FBlasterInputPacket::MaxFrames)
+	{
+		FMemory::Memmove(InputHistory, InputHistory + 1, FBlasterInputPacket::MaxFrames - 1);
+		--NumInputHistory;
+	}
+	InputHistory[NumInputHistory++] = Buttons;
+
+	// Changes within MinInputSendInterval of the last packet ride along with the next one
+	FTimerManager& TimerManager = GetWorld()->GetTimerManager();
+	const float SendDelay = MinInputSendInterval - static_cast<float>(GetWorld()->GetTimeSeconds() - LastInputSendTime);
+	if (SendDelay <= 0.f)
+		SendInputPacket();
+	else if (!TimerManager.IsTimerActive(InputSendTimer) || TimerManager.GetTimerRemaining(InputSendTimer) > SendDelay)
+		TimerManager.SetTimer(InputSendTimer, this, &UCombatComponent::SendInputPacket, SendDelay);
+}
+
+void UCombatComponent::SendInputPacket()
+{
+	const int32 NumUnacked = static_cast<int16>(InputSequence - CombatAck.InputSequence);
+	if (NumUnacked <= 0)
+		return;
+
+	// Older frames than the history holds are lost for good, the newest one always carries the current state
+	FBlasterInputPacket Packet;
+	Packet.LastSequence = InputSequence;
+	Packet.NumFrames = static_cast<uint8>(FMath::Min(NumUnacked, NumInputHistory));
+	FMemory::Memcpy(Packet.Buttons, InputHistory + NumInputHistory - Packet.NumFrames, Packet.NumFrames);
+
+	ServerCombatInput(Packet);
+	CountServerRpc(EBlasterTelemetryRpc::CombatInput, false);
+	INC_DWORD_STAT(STAT_BlasterInputRpcsSent);
+
+	LastInputSendTime = GetWorld()->GetTimeSeconds();
+
+	// Keep repeating until CombatAck covers InputSequence
+	GetWorld()->GetTimerManager().SetTimer(InputSendTimer, this, &UCombatComponent::SendInputPacket, InputResendInterval);
+}
+
+void UCombatComponent::ServerCombatInput_Implementation(const FBlasterInputPacket& Packet)
+{
+	BLASTER_SCOPE_CYCLE_COUNTER(STAT_BlasterCombatInput, BlasterCombatChannel);
+	CountServerRpc(EBlasterTelemetryRpc::CombatInput, false);
+
+	bool bApplied = false;
+	for (int32 FrameIndex = 0; FrameIndex < Packet.NumFrames; ++FrameIndex)
+	{
+		const uint16 Sequence = Packet.GetSequence(FrameIndex);
+		if (!IsSequenceNewer(Sequence, LastInputSequence))
+		{
+			INC_DWORD_STAT(STAT_BlasterInputFramesDeduplicated);
+			continue;
+		}
+
+		LastInputSequence = Sequence;
+		ApplyAiming((Packet.Buttons[FrameIndex] & InputButton_Aim) != 0);
+		bFireButtonPressed = (Packet.Buttons[FrameIndex] & InputButton_Fire) != 0;
+		bApplied = true;
+	}
+
+	if (bApplied)
+		RefreshCombatAck();
 }
 
-void UCombatComponent::ServerSetAiming_Implementation(bool IsAiming)
+void UCombatComponent::CountServerRpc(EBlasterTelemetryRpc Rpc, bool bReliable)
+{
+	if (GetOwner()->HasAuthority())
+	{
+		UBlasterTelemetrySubsystem* Telemetry = GetWorld()->GetGameInstance() ? GetWorld()->GetGameInstance()->GetSubsystem<UBlasterTelemetrySubsystem>() : nullptr;
+		if (Telemetry)
+			Telemetry->CountRpc(Rpc);
+	}
+
+	++NumServerRpcs;
+	if (bReliable)
+	{
+		++NumReliableServerRpcs;
+		INC_DWORD_STAT(STAT_BlasterReliableServerRpcs);
+	}
+}
+
+float UCombatComponent::ConsumeServerRpcRate(int32& OutNumReliable)
+{
+	// Game time, the clock the input send and resend timers run on
+	const double Now = GetWorld()->GetTimeSeconds();
+	const double Elapsed = Now - ServerRpcWindowStart;
+	const float Rate = Elapsed > 0.0 ? static_cast<float>(NumServerRpcs / Elapsed) : 0.f;
+
+	OutNumReliable = NumReliableServerRpcs;
+	NumServerRpcs = 0;
+	NumReliableServerRpcs = 0;
+	ServerRpcWindowStart = Now;
+
+	return Rate;
+}
+
+int32 UCombatComponent::GetReliableBufferOccupancy() const
+{
+	UNetConnection* Connection = GetOwner() ? GetOwner()->GetNetConnection() : nullptr;
+	if (!Connection)
+		return 0;
+
+	UActorChannel* Channel = Connection->FindActorChannelRef(GetOwner());
+	return Channel ? Channel->NumOutRec : 0;
+}
+
+void UCombatComponent::ApplyAiming(bool IsAiming)
 {
 	bIsAiming = IsAiming;
-	if (Character)
-		Character->GetCharacterMovement()->MaxWalkSpeed = bIsAiming ? AimWalkSpeed : BaseWalkSpeed;
+
+	// Speed goes through the saved moves, the server reads it from the client's move flags
+	if (Character && Character->IsLocallyControlled())
+	{
+		UBlasterCharacterMovementComponent* BlasterMovement = Cast<UBlasterCharacterMovementComponent>(Character->GetCharacterMovement());
+		if (BlasterMovement)
+			BlasterMovement->SetWantsToAim(bIsAiming);
+	}
 }
 
-void UCombatComponent::OnRep_EquippedWeapon()
+FBlasterPredictedAction& UCombatComponent::PushPendingAction(EBlasterPredictedActionType Type)
+{
+	// A full buffer means the server is far behind, the oldest guess is dropped and the next ack settles it
+	if (NumPendingActions == MaxPendingActions)
+	{
+		PendingHead = (PendingHead + 1) % MaxPendingActions;
+		--NumPendingActions;
+		DEC_DWORD_STAT(STAT_BlasterPredictedActionsPending);
+	}
+
+	FBlasterPredictedAction& Action = PendingActions[(PendingHead + NumPendingActions) % MaxPendingActions];
+	Action = FBlasterPredictedAction();
+	Action.Sequence = ++NextSequence;
+	Action.Type = Type;
+
+	++NumPendingActions;
+	INC_DWORD_STAT(STAT_BlasterPredictedActionsPending);
+
+	return Action;
+}
+
+void UCombatComponent::RefreshCombatAck()
+{
+	if (!GetOwner() || !GetOwner()->HasAuthority())
+		return;
+
+	CombatAck.Sequence = LastAckedSequence;
+	CombatAck.InputSequence = LastInputSequence;
+	CombatAck.bIsAiming = bIsAiming;
+	CombatAck.EquippedWeapon = EquippedWeapon;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UCombatComponent, CombatAck, this);
+	PushModelTracker.MarkDirty(PushProperty_CombatAck);
+}
+
+void UCombatComponent::OnRep_CombatAck()
+{
+	BLASTER_SCOPE_CYCLE_COUNTER(STAT_BlasterCombatAck, BlasterCombatChannel);
+
+	// Forget what the server has already processed, undoing equips it refused
+	while (NumPendingActions > 0 && !IsSequenceNewer(PendingActions[PendingHead].Sequence, CombatAck.Sequence))
+	{
+		const FBlasterPredictedAction& Action = PendingActions[PendingHead];
+
+		AWeapon* PredictedWeapon = Action.Weapon.Get();
+		if (Action.Type == EBlasterPredictedActionType::Equip && PredictedWeapon && PredictedWeapon != CombatAck.EquippedWeapon
+			&& PredictedWeapon->GetAttachParentActor() == Character)
+		{
+			PredictedWeapon->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+			PredictedWeapon->SetActorTransform(Action.WeaponTransform);
+			INC_DWORD_STAT(STAT_BlasterPredictedEquipsRolledBack);
+		}
+
+		PendingHead = (PendingHead + 1) % MaxPendingActions;
+		--NumPendingActions;
+		DEC_DWORD_STAT(STAT_BlasterPredictedActionsPending);
+	}
+
+	// Start from the acknowledged server state and replay what it has not seen yet, so stale state never wins
+	AWeapon* PredictedWeapon = CombatAck.EquippedWeapon;
+	for (int32 Offset = 0; Offset < NumPendingActions; ++Offset)
+	{
+		const FBlasterPredictedAction& Action = PendingActions[(PendingHead + Offset) % MaxPendingActions];
+		if (Action.Weapon.IsValid())
+			PredictedWeapon = Action.Weapon.Get();
+	}
+
+	// Input has its own sequence, our aim only yields once the server has seen our latest frame
+	bool bPredictedAiming = bIsAiming;
+	if (!IsSequenceNewer(InputSequence, CombatAck.InputSequence))
+	{
+		bPredictedAiming = CombatAck.bIsAiming;
+		GetWorld()->GetTimerManager().ClearTimer(InputSendTimer);
+	}
+
+	if (bPredictedAiming != bIsAiming)
+		ApplyAiming(bPredictedAiming);
+
+	// Rolling back to empty hands has to undo the orientation the mispredicted equip set up
+	if (PredictedWeapon != EquippedWeapon)
+	{
+		EquippedWeapon = PredictedWeapon;
+		ApplyEquippedOrientation();
+	}
+}
+
+void UCombatComponent::FireButtonPressed(bool bPressed)
+{
+	bFireButtonPressed = bPressed;
+
+	if (GetOwner() && !GetOwner()->HasAuthority())
+		RecordInputFrame();
+
+	if (bFireButtonPressed && EquippedWeapon)
+		Fire();
+}
+
+void UCombatComponent::Fire()
+{
+	// Last frame's async result is fresh enough to aim with, only bots and the first frame pay for a sync trace
+	FHitResult TraceHitResult;
+	if (HasCrosshairHit())
+	{
+		TraceHitResult = CrosshairHit;
+	}
+	else
+	{
+		TraceUnderCrosshairs(TraceHitResult);
+		INC_DWORD_STAT(STAT_BlasterCrosshairSyncFallbacks);
+	}
+
+	const FVector TraceHitTarget = TraceHitResult.bBlockingHit ? TraceHitResult.ImpactPoint : TraceHitResult.TraceEnd;
+	ServerFire(TraceHitTarget);
+	if (!GetOwner()->HasAuthority())
+		CountServerRpc(EBlasterTelemetryRpc::Fire, false);
+
+	// Projectiles are flown and scored by the server
+	if (Cast<AProjectileWeapon>(EquippedWeapon))
+		return;
+
+	ABlasterCharacter* HitCharacter = Cast<ABlasterCharacter>(TraceHitResult.GetActor());
+	if (HitCharacter && HitCharacter != Character)
+	{
+		const AGameStateBase* GameState = GetWorld()->GetGameState();
+		const double HitTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+
+		ServerScoreRequest(HitCharacter, TraceHitResult.TraceStart, TraceHitResult.ImpactPoint, HitTime);
+		if (!GetOwner()->HasAuthority())
+			CountServerRpc(EBlasterTelemetryRpc::ScoreRequest, true);
+	}
+}
+
+bool UCombatComponent::GetCrosshairRay(FVector& OutStart, FVector& OutEnd) const
+{
+	if (!Character || !EquippedWeapon)
+		return false;
+
+	FVector2D ViewportSize;
+	if (GEngine && GEngine->GameViewport)
+		GEngine->GameViewport->GetViewportSize(ViewportSize);
+
+	const FVector2D CrosshairLocation(ViewportSize.X / 2.f, ViewportSize.Y / 2.f);
+	FVector CrosshairWorldPosition;
+	FVector CrosshairWorldDirection;
+
+	const bool bScreenToWorld = UGameplayStatics::DeprojectScreenToWorld(
+		Cast<APlayerController>(Character->GetController()),
+		CrosshairLocation,
+		CrosshairWorldPosition,
+		CrosshairWorldDirection
+	);
+
+	if (!bScreenToWorld)
+		return false;
+
+	// Start in front of the character so nothing between the camera and the character gets hit
+	const float DistanceToCharacter = (Character->GetActorLocation() - CrosshairWorldPosition).Size();
+	OutStart = CrosshairWorldPosition + CrosshairWorldDirection * (DistanceToCharacter + 100.f);
+	OutEnd = OutStart + CrosshairWorldDirection * EquippedWeapon->GetFireRange();
+	return true;
+}
+
+void UCombatComponent::TraceUnderCrosshairs(FHitResult& TraceHitResult)
+{
+	BLASTER_SCOPE_CYCLE_COUNTER(STAT_BlasterCrosshairTrace, BlasterCombatChannel);
+
+	FVector Start;
+	FVector End;
+	if (!GetCrosshairRay(Start, End))
+		return;
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(BlasterCrosshair), false, Character);
+
+	if (!GetWorld()->LineTraceSingleByChannel(TraceHitResult, Start, End, ECollisionChannel::ECC_Visibility, QueryParams))
+	{
+		TraceHitResult.TraceStart = Start;
+		TraceHitResult.TraceEnd = End;
+	}
+}
+
+void UCombatComponent::UpdateCrosshairTrace()
 {
-	if (EquippedWeapon && Character)
+	BLASTER_SCOPE_CYCLE_COUNTER(STAT_BlasterCrosshairTrace, BlasterCombatChannel);
+
+	FVector Start;
+	FVector End;
+	if (!GetCrosshairRay(Start, End))
 	{
-		Character->GetCharacterMovement()->bOrientRotationToMovement = false;
-		Character->bUseControllerRotationYaw = true;
+		CrosshairHitFrame = 0;
+		return;
 	}
+
+	// The result is delivered through OnCrosshairTraceDone when the world collects the async batch next frame
+	const uint32 Slot = NumCrosshairTracesIssued++ % MaxCrosshairTracesInFlight;
+	CrosshairTraceIssueTimes[Slot] = FPlatformTime::Seconds();
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(BlasterCrosshair), false, Character);
+	GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, ECollisionChannel::ECC_Visibility,
+		QueryParams, FCollisionResponseParams::DefaultResponseParam, &CrosshairTraceDelegate, Slot);
+}
+
+void UCombatComponent::OnCrosshairTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
+{
+	const double IssueTime = CrosshairTraceIssueTimes[TraceDatum.UserData % MaxCrosshairTracesInFlight];
+	SET_FLOAT_STAT(STAT_BlasterCrosshairTraceLatency, static_cast<float>((FPlatformTime::Seconds() - IssueTime) * 1000.0));
+
+	// Weapon may have been dropped while the trace was in flight
+	if (!EquippedWeapon)
+		return;
+
+	// Results come back in issue order, so the newest one always wins
+	if (TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit)
+		CrosshairHit = TraceDatum.OutHits[0];
+	else
+		CrosshairHit = FHitResult();
+
+	CrosshairHit.TraceStart = TraceDatum.Start;
+	CrosshairHit.TraceEnd = TraceDatum.End;
+	CrosshairHitFrame = GFrameCounter;
+}
+
+bool UCombatComponent::HasCrosshairHit() const
+{
+	// Traces are issued every frame, anything older means nobody is updating them any more
+	return EquippedWeapon && CrosshairHitFrame != 0 && GFrameCounter - CrosshairHitFrame <= 2;
+}
+
+void UCombatComponent::ServerFire_Implementation(const FVector_NetQuantize& TraceHitTarget)
+{
+	CountServerRpc(EBlasterTelemetryRpc::Fire, false);
+
+	if (!Character || !EquippedWeapon || !ConsumeFireInterval(LastServerFireTime))
+		return;
+
+	// Anyone near the shot may be the subject of a score request soon, their hit boxes need full rate poses
+	UBlasterTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UBlasterTickSubsystem>();
+	if (TickSubsystem)
+		TickSubsystem->NotifyShot(Character->GetActorLocation(), TraceHitTarget);
+
+	AProjectileWeapon* ProjectileWeapon = Cast<AProjectileWeapon>(EquippedWeapon);
+	if (ProjectileWeapon)
+	{
+		// Checked before the multicast, so a capped shot is not sent to anyone
+		UBlasterProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UBlasterProjectileSubsystem>();
+		if (Projectiles && !Projectiles->CanShooterSpawn(Character))
+			return;
+
+		MulticastFireProjectile(ProjectileWeapon->MakeProjectileSpawn(TraceHitTarget));
+	}
+	else
+	{
+		MulticastFire(TraceHitTarget);
+	}
+}
+
+void UCombatComponent::MulticastFire_Implementation(const FVector_NetQuantize& TraceHitTarget)
+{
+	if (EquippedWeapon)
+		EquippedWeapon->Fire(TraceHitTarget);
+}
+
+void UCombatComponent::MulticastFireProjectile_Implementation(const FBlasterProjectileSpawn& Spawn)
+{
+	AProjectileWeapon* ProjectileWeapon = Cast<AProjectileWeapon>(EquippedWeapon);
+	if (ProjectileWeapon)
+		ProjectileWeapon->FireProjectile(Spawn);
+}
+
+void UCombatComponent::ServerScoreRequest_Implementation(ABlasterCharacter* HitCharacter, const FVector_NetQuantize& TraceStart, const FVector_NetQuantize& HitLocation, double HitTime)
+{
+	BLASTER_SCOPE_CYCLE_COUNTER(STAT_BlasterScoreRequest, BlasterCombatChannel);
+	CountServerRpc(EBlasterTelemetryRpc::ScoreRequest, true);
+
+	if (!Character || !EquippedWeapon || !HitCharacter || HitCharacter == Character)
+		return;
+
+	// Projectiles are scored on impact by the server, a hitscan request for one is never legitimate
+	if (Cast<AProjectileWeapon>(EquippedWeapon))
+		return;
+
+	ULagCompensationComponent* LagCompensation = HitCharacter->GetLagCompensation();
+	if (!LagCompensation)
+		return;
+
+	if (FVector::DistSquared(TraceStart, Character->GetActorLocation()) > FMath::Square(MaxTraceStartDistance))
+		return;
+
+	const float FireRange = EquippedWeapon->GetFireRange();
+	const float HitDistance = FVector::Dist(TraceStart, HitLocation);
+	if (HitDistance > FireRange)
+		return;
+
+	if (!IsHitTimePlausible(HitTime) || !ConsumeFireInterval(LastScoreRequestTime))
+		return;
+
+	// Extend past the reported hit location so quantization can't make the trace stop short of the box, never past the range
+	const FVector TraceEnd = TraceStart + (HitLocation - TraceStart).GetSafeNormal() * FMath::Min(HitDistance * 1.25f, FireRange);
+
+	const FServerSideRewindResult Confirm = LagCompensation->ServerSideRewind(TraceStart, TraceEnd, HitTime);
+	if (Confirm.bHitConfirmed)
+	{
+		UGameplayStatics::ApplyDamage(
+			HitCharacter,
+			EquippedWeapon->GetDamage() * Confirm.DamageMultiplier,
+			Character->GetController(),
+			EquippedWeapon,
+			UDamageType::StaticClass()
+		);
+	}
+}
+
+bool UCombatComponent::ConsumeFireInterval(double& LastTime) const
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (Now - LastTime < EquippedWeapon->GetFireInterval() - FireIntervalTolerance)
+		return false;
+
+	LastTime = Now;
+	return true;
+}
+
+bool UCombatComponent::IsHitTimePlausible(double HitTime) const
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	const double Now = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+	if (HitTime > Now + MaxHitTimeAhead)
+		return false;
+
+	// The listen server's own character has no connection and sees everything as it is
+	const UNetConnection* Connection = Character->GetNetConnection();
+	const double RoundTripTime = Connection ? Connection->AvgLag : 0.0;
+	return HitTime >= Now - RoundTripTime - MaxRewindSlack;
+}
+
+void UCombatComponent::OnRep_EquippedWeapon()
+{
+	ApplyEquippedOrientation();
 }
 
 void UCombatComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
@@ -80,7 +727,21 @@ void UCombatComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& Out
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UCombatComponent, EquippedWeapon);
-	DOREPLIFETIME(UCombatComponent, bIsAiming);
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
+	// The owner predicts its equipped weapon and reconciles through CombatAck instead
+	Params.Condition = COND_SkipOwner;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UCombatComponent, EquippedWeapon, Params);
+
+	Params.Condition = COND_OwnerOnly;
+	DOREPLIFETIME_WITH_PARAMS_FAST(UCombatComponent, CombatAck, Params);
+}
+
+void UCombatComponent::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	INC_DWORD_STAT_BY(STAT_BlasterPushSkippedCombat, PushModelTracker.ConsumeSkipped(PushProperty_MAX));
 }
 
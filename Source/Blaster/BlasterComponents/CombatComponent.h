@@ -4,9 +4,89 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "Blaster/BlasterNet/BlasterPushModel.h"
+#include "Blaster/BlasterSubsystems/BlasterProjectileSubsystem.h"
+#include "WorldCollision.h"
 #include "CombatComponent.generated.h"
 
 class AWeapon;
+enum class EBlasterTelemetryRpc : uint8;
+
+enum class EBlasterPredictedActionType : uint8
+{
+	Equip
+};
+
+// An action the owning client applied locally before the server confirmed it
+struct FBlasterPredictedAction
+{
+	uint16 Sequence = 0;
+	EBlasterPredictedActionType Type = EBlasterPredictedActionType::Equip;
+	TWeakObjectPtr<AWeapon> Weapon;
+
+	// Where the weapon was before it was predicted into our hands, restored if the server says no
+	FTransform WeaponTransform;
+};
+
+// Server state sent to the owner only, together with the last predicted action it has processed
+USTRUCT()
+struct FBlasterCombatAck
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint16 Sequence = 0;
+
+	// Last input frame processed, see FBlasterInputPacket
+	UPROPERTY()
+	uint16 InputSequence = 0;
+
+	UPROPERTY()
+	bool bIsAiming = false;
+
+	UPROPERTY()
+	AWeapon* EquippedWeapon = nullptr;
+};
+
+enum EBlasterInputButton : uint8
+{
+	InputButton_Aim = 1 << 0,
+	InputButton_Fire = 1 << 1,
+
+	InputButton_NumBits = 2
+};
+
+/**
+ * Combat button state sent unreliably from the owning client. A frame is recorded whenever the
+ * buttons change and every packet repeats the newest frames the server has not acknowledged, so a
+ * lost packet is covered by the next one. Frames are consecutive, only the newest sequence is sent.
+ */
+USTRUCT()
+struct FBlasterInputPacket
+{
+	GENERATED_BODY()
+
+	static constexpr int32 MaxFrames = 4;
+
+	uint16 LastSequence = 0;
+	uint8 NumFrames = 0;
+
+	// Oldest first, Buttons[NumFrames - 1] belongs to LastSequence
+	uint8 Buttons[MaxFrames] = {};
+
+	FORCEINLINE uint16 GetSequence(int32 FrameIndex) const { return static_cast<uint16>(LastSequence - (NumFrames - 1 - FrameIndex)); }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FBlasterInputPacket> : public TStructOpsTypeTraitsBase2<FBlasterInputPacket>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class BLASTER_API UCombatComponent : public UActorComponent
@@ -17,21 +97,78 @@ public:
 	// Sets default values for this component's properties
 	UCombatComponent();
 	friend class ABlasterCharacter;
+	friend class FBlasterCombatReconcileTest;
+	friend class FBlasterCombatInputLossTest;
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 
 	void EquipWeapon(class AWeapon * WeaponToEquip);
+
+	// Server side, leaves the equipped weapon lying where it is
+	void DropWeapon();
+
+	// Owning client: equips right away and lets the server confirm or roll it back
+	void PredictEquipWeapon(AWeapon* WeaponToEquip);
+	void FireButtonPressed(bool bPressed);
+
+	// Owning client, once per frame: takes in the last crosshair trace result and issues the next one asynchronously
+	void UpdateCrosshairTrace();
+
+	// True while the last completed crosshair trace is fresh enough for Fire() to aim with, false before the first one or without a weapon
+	bool HasCrosshairHit() const;
 protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 	void SetAiming(bool IsAiming);
 
+	// Button state is cheap to lose and resend, so it never touches the reliable buffer
+	UFUNCTION(Server, Unreliable)
+	void ServerCombatInput(const FBlasterInputPacket& Packet);
+
+	// Equipping changes game state and stays reliable
 	UFUNCTION(Server, Reliable)
-	void ServerSetAiming(bool IsAiming);
+	void ServerEquipWeapon(uint16 Sequence);
+
+	void RecordInputFrame();
+	void SendInputPacket();
+	void CountServerRpc(EBlasterTelemetryRpc Rpc, bool bReliable);
 
 	UFUNCTION()
 	void OnRep_EquippedWeapon();
 
+	UFUNCTION()
+	void OnRep_CombatAck();
+
+	void ApplyAiming(bool IsAiming);
+	void AttachEquippedWeapon();
+	void ApplyEquippedOrientation();
+
+	// The owner's side of PredictEquipWeapon, without the RPC
+	const FBlasterPredictedAction* ApplyPredictedEquip(AWeapon* WeaponToEquip);
+	void RefreshCombatAck();
+	FBlasterPredictedAction& PushPendingAction(EBlasterPredictedActionType Type);
+
+	void Fire();
+	bool GetCrosshairRay(FVector& OutStart, FVector& OutEnd) const;
+	void TraceUnderCrosshairs(FHitResult& TraceHitResult);
+	void OnCrosshairTraceDone(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
+	// Cosmetic only, damage goes through ServerScoreRequest
+	UFUNCTION(Server, Unreliable)
+	void ServerFire(const FVector_NetQuantize& TraceHitTarget);
+
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastFire(const FVector_NetQuantize& TraceHitTarget);
+
+	// Projectile weapons, the shot itself is simulated from the event on every machine
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastFireProjectile(const FBlasterProjectileSpawn& Spawn);
+
+	// Asks the server to confirm a hit the client saw at HitTime (server clock) by rewinding the hit character
+	UFUNCTION(Server, Reliable)
+	void ServerScoreRequest(class ABlasterCharacter* HitCharacter, const FVector_NetQuantize& TraceStart, const FVector_NetQuantize& HitLocation, double HitTime);
+
 private:
 
 	class ABlasterCharacter* Character;
@@ -39,17 +176,99 @@ private:
 	UPROPERTY(ReplicatedUsing = OnRep_EquippedWeapon)
   AWeapon* EquippedWeapon;
 
-	UPROPERTY(Replicated)
+	// Owner gets it through CombatAck, everyone else through ABlasterCharacter::AimState
 	bool bIsAiming;
 
+	UPROPERTY(ReplicatedUsing = OnRep_CombatAck)
+	FBlasterCombatAck CombatAck;
+
+	// Server side, sequence of the last predicted action received from the owner
+	uint16 LastAckedSequence;
+
+	// Owner side ring buffer of actions the server has not acknowledged yet
+	static constexpr int32 MaxPendingActions = 16;
+	FBlasterPredictedAction PendingActions[MaxPendingActions];
+	int32 PendingHead;
+	int32 NumPendingActions;
+	uint16 NextSequence;
+
+	// Owner side input channel state
+	uint16 InputSequence;
+	uint8 LastInputButtons;
+	uint8 InputHistory[FBlasterInputPacket::MaxFrames];
+	int32 NumInputHistory;
+	double LastInputSendTime;
+	FTimerHandle InputSendTimer;
+
+	// Server side, last input frame applied
+	uint16 LastInputSequence;
+
+	// Minimum time between two input packets, changes in between are coalesced
+	UPROPERTY(EditAnywhere)
+	float MinInputSendInterval;
+
+	// Unacknowledged input is sent again at this interval
+	UPROPERTY(EditAnywhere)
+	float InputResendInterval;
+
 	UPROPERTY(EditAnywhere)
 	float BaseWalkSpeed;
 
 	UPROPERTY(EditAnywhere)
 	float AimWalkSpeed;
 
+	bool bFireButtonPressed;
+
+	// Score requests whose trace starts further than this from the shooter are rejected
+	UPROPERTY(EditAnywhere)
+	float MaxTraceStartDistance;
+
+	// Shots may arrive this much closer together than the weapon's fire interval, network jitter bunches them up
+	UPROPERTY(EditAnywhere)
+	float FireIntervalTolerance;
+
+	// Score requests may claim a hit time this far past the server's clock
+	UPROPERTY(EditAnywhere)
+	float MaxHitTimeAhead;
+
+	// On top of the shooter's round trip time, covers the interpolation delay of what the shooter saw
+	UPROPERTY(EditAnywhere)
+	float MaxRewindSlack;
+
+	// Server side, game time of the last score request and shot accepted
+	double LastScoreRequestTime;
+	double LastServerFireTime;
+
+	// Server side, true and stamps LastTime when the equipped weapon's fire interval has passed since it
+	bool ConsumeFireInterval(double& LastTime) const;
+
+	// Server side, false when HitTime is ahead of the server clock or further back than the shooter can have seen
+	bool IsHitTimePlausible(double HitTime) const;
+
+	// Owner side crosshair trace, results arrive the frame after the trace is issued
+	FTraceDelegate CrosshairTraceDelegate;
+	FHitResult CrosshairHit;
+	uint64 CrosshairHitFrame;
+
+	// Issue times of the traces in flight, indexed by the trace's user data
+	static constexpr int32 MaxCrosshairTracesInFlight = 4;
+	double CrosshairTraceIssueTimes[MaxCrosshairTracesInFlight];
+	uint32 NumCrosshairTracesIssued;
+
+	// Replicated state is push based, setters mark it dirty here and through MARK_PROPERTY_DIRTY_FROM_NAME
+	enum EPushProperty { PushProperty_EquippedWeapon, PushProperty_CombatAck, PushProperty_MAX };
+	FBlasterPushModelTracker PushModelTracker;
+
 public:	
-	// Called every frame
+	// Server RPCs sent (owner) or received (server) per second since the last call, resets the window
+	float ConsumeServerRpcRate(int32& OutNumReliable);
 
-		
+	// Outgoing reliable bunches waiting for an ack on this machine's end of the owner's actor channel,
+	// out of RELIABLE_BUFFER. Server RPCs on the owning client, client RPCs and properties on the server
+	int32 GetReliableBufferOccupancy() const;
+
+private:
+	int32 NumServerRpcs;
+	int32 NumReliableServerRpcs;
+	double ServerRpcWindowStart;
 };
@@ -0,0 +1,221 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensationComponent.h"
+#include "Blaster/Blaster.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag Comp Record Frame"), STAT_BlasterLagCompRecordFrame, STATGROUP_Blaster);
+DECLARE_CYCLE_STAT(TEXT("Lag Comp Rewind"), STAT_BlasterLagCompRewind, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lag Comp Rewound Shots"), STAT_BlasterLagCompRewoundShots, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lag Comp Rejected Shots"), STAT_BlasterLagCompRejectedShots, STATGROUP_Blaster);
+
+ULagCompensationComponent::ULagCompensationComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	MaxRecordTime = 0.5f;
+	MaxFrames = 64;
+	Head = 0;
+	NumFrames = 0;
+
+	auto AddHitBox = [this](const TCHAR* BoneName, const FVector& HalfExtent, float DamageMultiplier = 1.f)
+	{
+		FHitBoxDefinition& HitBox = HitBoxes.AddDefaulted_GetRef();
+		HitBox.BoneName = FName(BoneName);
+		HitBox.HalfExtent = HalfExtent;
+		HitBox.DamageMultiplier = DamageMultiplier;
+	};
+
+	AddHitBox(TEXT("head"), FVector(12.f, 12.f, 12.f), 2.f);
+	AddHitBox(TEXT("pelvis"), FVector(16.f, 18.f, 14.f));
+	AddHitBox(TEXT("spine_02"), FVector(16.f, 20.f, 14.f));
+	AddHitBox(TEXT("spine_03"), FVector(16.f, 22.f, 16.f));
+	AddHitBox(TEXT("upperarm_l"), FVector(16.f, 6.f, 6.f));
+	AddHitBox(TEXT("upperarm_r"), FVector(16.f, 6.f, 6.f));
+	AddHitBox(TEXT("lowerarm_l"), FVector(14.f, 5.f, 5.f));
+	AddHitBox(TEXT("lowerarm_r"), FVector(14.f, 5.f, 5.f));
+	AddHitBox(TEXT("hand_l"), FVector(8.f, 5.f, 5.f));
+	AddHitBox(TEXT("hand_r"), FVector(8.f, 5.f, 5.f));
+	AddHitBox(TEXT("thigh_l"), FVector(22.f, 9.f, 9.f));
+	AddHitBox(TEXT("thigh_r"), FVector(22.f, 9.f, 9.f));
+	AddHitBox(TEXT("calf_l"), FVector(22.f, 7.f, 7.f));
+	AddHitBox(TEXT("calf_r"), FVector(22.f, 7.f, 7.f));
+	AddHitBox(TEXT("foot_l"), FVector(12.f, 5.f, 5.f));
+	AddHitBox(TEXT("foot_r"), FVector(12.f, 5.f, 5.f));
+}
+
+void ULagCompensationComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!Character || !Character->HasAuthority() || MaxFrames <= 0)
+		return;
+
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+	if (!Mesh || !Capsule)
+		return;
+
+	float MaxBoxExtent = 0.f;
+	for (const FHitBoxDefinition& HitBox : HitBoxes)
+	{
+		const int32 BoneIndex = Mesh->GetBoneIndex(HitBox.BoneName);
+		if (BoneIndex == INDEX_NONE)
+			continue;
+
+		BoneIndices.Add(BoneIndex);
+		BoxHalfExtents.Add(HitBox.HalfExtent);
+		BoxDamageMultipliers.Add(HitBox.DamageMultiplier);
+		MaxBoxExtent = FMath::Max(MaxBoxExtent, HitBox.HalfExtent.Size());
+	}
+
+	// Limbs can stick out of the capsule, so the broadphase radius covers the largest box
+	CapsuleHalfHeight = Capsule->GetScaledCapsuleHalfHeight();
+	BroadphaseRadius = Capsule->GetScaledCapsuleRadius() + MaxBoxExtent;
+
+	const int32 NumBoxes = BoneIndices.Num();
+
+	FrameTimes.SetNumZeroed(MaxFrames);
+	CapsuleLocations.SetNumZeroed(MaxFrames);
+	BoxLocations.SetNumZeroed(MaxFrames * NumBoxes);
+	BoxRotations.SetNumZeroed(MaxFrames * NumBoxes);
+
+	RewoundBoxLocations.SetNumZeroed(NumBoxes);
+	RewoundBoxRotations.SetNumZeroed(NumBoxes);
+
+	Head = 0;
+	NumFrames = 0;
+
+	SetComponentTickEnabled(true);
+}
+
+void ULagCompensationComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	RecordFrame();
+}
+
+void ULagCompensationComponent::RecordFrame()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterLagCompRecordFrame);
+
+	if (!Character || FrameTimes.Num() != MaxFrames)
+		return;
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const int32 NumBoxes = BoneIndices.Num();
+	const USkeletalMeshComponent* Mesh = Character->GetMesh();
+
+	FrameTimes[Head] = Now;
+	CapsuleLocations[Head] = Character->GetCapsuleComponent()->GetComponentLocation();
+
+	const int32 FirstBox = Head * NumBoxes;
+	for (int32 BoxIndex = 0; BoxIndex < NumBoxes; ++BoxIndex)
+	{
+		const FTransform BoneTransform = Mesh->GetBoneTransform(BoneIndices[BoxIndex]);
+		BoxLocations[FirstBox + BoxIndex] = BoneTransform.GetLocation();
+		BoxRotations[FirstBox + BoxIndex] = BoneTransform.GetRotation();
+	}
+
+	Head = (Head + 1) % MaxFrames;
+	NumFrames = FMath::Min(NumFrames + 1, MaxFrames);
+
+	// Trim frames that are too old to ever be rewound to
+	while (NumFrames > 1 && Now - FrameTimes[SlotAt(0)] > MaxRecordTime)
+		--NumFrames;
+}
+
+bool ULagCompensationComponent::InterpolateFrame(double HitTime)
+{
+	if (NumFrames == 0 || HitTime < FrameTimes[SlotAt(0)])
+		return false;
+
+	const int32 NumBoxes = BoneIndices.Num();
+	const int32 Newest = SlotAt(NumFrames - 1);
+
+	if (HitTime >= FrameTimes[Newest] || NumFrames == 1)
+	{
+		RewoundCapsuleLocation = CapsuleLocations[Newest];
+		for (int32 BoxIndex = 0; BoxIndex < NumBoxes; ++BoxIndex)
+		{
+			RewoundBoxLocations[BoxIndex] = BoxLocations[Newest * NumBoxes + BoxIndex];
+			RewoundBoxRotations[BoxIndex] = BoxRotations[Newest * NumBoxes + BoxIndex];
+		}
+		return true;
+	}
+
+	int32 YoungerIndex = NumFrames - 1;
+	while (YoungerIndex > 1 && FrameTimes[SlotAt(YoungerIndex - 1)] > HitTime)
+		--YoungerIndex;
+
+	const int32 Younger = SlotAt(YoungerIndex);
+	const int32 Older = SlotAt(YoungerIndex - 1);
+	const double Span = FrameTimes[Younger] - FrameTimes[Older];
+	const float Alpha = Span > 0.0 ? FMath::Clamp(static_cast<float>((HitTime - FrameTimes[Older]) / Span), 0.f, 1.f) : 1.f;
+
+	RewoundCapsuleLocation = FMath::Lerp(CapsuleLocations[Older], CapsuleLocations[Younger], Alpha);
+	for (int32 BoxIndex = 0; BoxIndex < NumBoxes; ++BoxIndex)
+	{
+		RewoundBoxLocations[BoxIndex] = FMath::Lerp(BoxLocations[Older * NumBoxes + BoxIndex], BoxLocations[Younger * NumBoxes + BoxIndex], Alpha);
+		RewoundBoxRotations[BoxIndex] = FQuat::Slerp(BoxRotations[Older * NumBoxes + BoxIndex], BoxRotations[Younger * NumBoxes + BoxIndex], Alpha);
+	}
+
+	return true;
+}
+
+bool ULagCompensationComponent::TraceCapsule(const FVector& Start, const FVector& End, const FVector& CapsuleLocation) const
+{
+	const FVector AxisOffset(0.f, 0.f, CapsuleHalfHeight);
+
+	FVector PointOnTrace;
+	FVector PointOnAxis;
+	FMath::SegmentDistToSegmentSafe(Start, End, CapsuleLocation - AxisOffset, CapsuleLocation + AxisOffset, PointOnTrace, PointOnAxis);
+
+	return FVector::DistSquared(PointOnTrace, PointOnAxis) <= FMath::Square(BroadphaseRadius);
+}
+
+bool ULagCompensationComponent::TraceBox(const FVector& Start, const FVector& End, const FVector& Location, const FQuat& Rotation, const FVector& HalfExtent) const
+{
+	const FVector LocalStart = Rotation.UnrotateVector(Start - Location);
+	const FVector LocalEnd = Rotation.UnrotateVector(End - Location);
+
+	return FMath::LineBoxIntersection(FBox(-HalfExtent, HalfExtent), LocalStart, LocalEnd, LocalEnd - LocalStart);
+}
+
+FServerSideRewindResult ULagCompensationComponent::ServerSideRewind(const FVector& TraceStart, const FVector& TraceEnd, double HitTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterLagCompRewind);
+
+	FServerSideRewindResult Result;
+
+	if (!InterpolateFrame(HitTime))
+	{
+		INC_DWORD_STAT(STAT_BlasterLagCompRejectedShots);
+		return Result;
+	}
+
+	INC_DWORD_STAT(STAT_BlasterLagCompRewoundShots);
+
+	if (!TraceCapsule(TraceStart, TraceEnd, RewoundCapsuleLocation))
+		return Result;
+
+	const int32 NumBoxes = BoneIndices.Num();
+	for (int32 BoxIndex = 0; BoxIndex < NumBoxes; ++BoxIndex)
+	{
+		if (!TraceBox(TraceStart, TraceEnd, RewoundBoxLocations[BoxIndex], RewoundBoxRotations[BoxIndex], BoxHalfExtents[BoxIndex]))
+			continue;
+
+		// A trace can pass through several boxes, the most damaging one wins
+		if (!Result.bHitConfirmed || BoxDamageMultipliers[BoxIndex] > Result.DamageMultiplier)
+			Result.DamageMultiplier = BoxDamageMultipliers[BoxIndex];
+
+		Result.bHitConfirmed = true;
+	}
+
+	return Result;
+}
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "LagCompensationComponent.generated.h"
+
+USTRUCT()
+struct FHitBoxDefinition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere)
+	FName BoneName;
+
+	UPROPERTY(EditAnywhere)
+	FVector HalfExtent = FVector(10.f);
+
+	UPROPERTY(EditAnywhere)
+	float DamageMultiplier = 1.f;
+};
+
+struct FServerSideRewindResult
+{
+	bool bHitConfirmed = false;
+	float DamageMultiplier = 1.f;
+};
+
+/**
+ * Keeps a short history of the owner's hit boxes on the server so that shots can be
+ * validated against where the shooter saw the character rather than where it is now.
+ *
+ * Frames are stored structure-of-arrays in a fixed-size ring buffer that is allocated once
+ * in BeginPlay; recording and rewinding never touch the heap.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class BLASTER_API ULagCompensationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULagCompensationComponent();
+	friend class ABlasterCharacter;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	FServerSideRewindResult ServerSideRewind(const FVector& TraceStart, const FVector& TraceEnd, double HitTime);
+
+	FORCEINLINE float GetMaxRecordTime() const { return MaxRecordTime; }
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	void RecordFrame();
+	FORCEINLINE int32 SlotAt(int32 FrameIndex) const { return (Head - NumFrames + FrameIndex + MaxFrames) % MaxFrames; }
+	bool InterpolateFrame(double HitTime);
+	bool TraceCapsule(const FVector& Start, const FVector& End, const FVector& CapsuleLocation) const;
+	bool TraceBox(const FVector& Start, const FVector& End, const FVector& Location, const FQuat& Rotation, const FVector& HalfExtent) const;
+
+	class ABlasterCharacter* Character;
+
+	UPROPERTY(EditAnywhere, Category = "Lag Compensation")
+	TArray<FHitBoxDefinition> HitBoxes;
+
+	// How far back in time a shot may be rewound, in seconds
+	UPROPERTY(EditAnywhere, Category = "Lag Compensation")
+	float MaxRecordTime;
+
+	// Ring buffer capacity, should cover MaxRecordTime at the server tick rate
+	UPROPERTY(EditAnywhere, Category = "Lag Compensation")
+	int32 MaxFrames;
+
+	//
+	// Hit boxes whose bones exist on the owner's mesh, resolved once in BeginPlay
+	//
+
+	TArray<int32> BoneIndices;
+	TArray<FVector> BoxHalfExtents;
+	TArray<float> BoxDamageMultipliers;
+
+	float CapsuleHalfHeight;
+	float BroadphaseRadius;
+
+	//
+	// Ring buffer, one entry per frame for times and capsules, NumBoxes entries per frame for boxes
+	//
+
+	TArray<double> FrameTimes;
+	TArray<FVector> CapsuleLocations;
+	TArray<FVector> BoxLocations;
+	TArray<FQuat> BoxRotations;
+
+	int32 Head;
+	int32 NumFrames;
+
+	//
+	// Scratch frame the rewind interpolates into
+	//
+
+	FVector RewoundCapsuleLocation;
+	TArray<FVector> RewoundBoxLocations;
+	TArray<FQuat> RewoundBoxRotations;
+};
@@ -2,4 +2,10 @@
 
 
 #include "BlasterGameModeBase.h"
+#include "HUD/BlasterHUD.h"
+
+ABlasterGameModeBase::ABlasterGameModeBase()
+{
+	HUDClass = ABlasterHUD::StaticClass();
+}
 
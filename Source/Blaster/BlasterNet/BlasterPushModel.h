@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+/**
+ * Remembers which push-based properties of an object were marked dirty since its last PreReplication.
+ *
+ * The net driver only compares push-based properties that were marked dirty, so every property left
+ * clean between two replications is a comparison skipped. Owners mirror each MARK_PROPERTY_DIRTY with
+ * MarkDirty and report ConsumeSkipped from PreReplication to their own stat.
+ */
+struct FBlasterPushModelTracker
+{
+	FORCEINLINE void MarkDirty(int32 PropertyIndex)
+	{
+		DirtyMask |= 1u << PropertyIndex;
+	}
+
+	FORCEINLINE int32 ConsumeSkipped(int32 NumProperties)
+	{
+		const int32 Skipped = NumProperties - FMath::CountBits(DirtyMask);
+		DirtyMask = 0;
+		return Skipped;
+	}
+
+private:
+	uint32 DirtyMask = 0;
+};
@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterReplicationGraph.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/Weapon/Weapon.h"
+#include "Engine/LevelScriptActor.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/PlayerController.h"
+#include "Net/UnrealNetwork.h"
+#include "ReplicationGraphTypes.h"
+#include "UObject/UObjectIterator.h"
+
+void UBlasterReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Explicit routing for the classes we know about, the rest is derived from their defaults below
+	ClassRepNodePolicies.Set(AReplicationGraphDebugActor::StaticClass(), EClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(ALevelScriptActor::StaticClass(), EClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(APlayerController::StaticClass(), EClassRepNodeMapping::NotRouted);
+	ClassRepNodePolicies.Set(AInfo::StaticClass(), EClassRepNodeMapping::RelevantAllConnections);
+	ClassRepNodePolicies.Set(ABlasterCharacter::StaticClass(), EClassRepNodeMapping::Spatialize_Dynamic);
+	ClassRepNodePolicies.Set(AWeapon::StaticClass(), EClassRepNodeMapping::Spatialize_Dormancy);
+
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+		if (!ActorCDO || !ActorCDO->GetIsReplicated())
+			continue;
+
+		// Skip blueprint skeleton and reinstancing classes
+		if (Class->GetName().StartsWith(TEXT("SKEL_")) || Class->GetName().StartsWith(TEXT("REINST_")))
+			continue;
+
+		// Classes under an explicitly mapped native parent, e.g. weapon blueprints, inherit its policy
+		if (!ClassRepNodePolicies.Get(Class))
+		{
+			EClassRepNodeMapping Policy = EClassRepNodeMapping::Spatialize_Dynamic;
+			if (ActorCDO->bAlwaysRelevant)
+				Policy = EClassRepNodeMapping::RelevantAllConnections;
+			else if (ActorCDO->bOnlyRelevantToOwner)
+				Policy = EClassRepNodeMapping::NotRouted;
+			else if (ActorCDO->GetRootComponent() && ActorCDO->GetRootComponent()->Mobility == EComponentMobility::Static)
+				Policy = EClassRepNodeMapping::Spatialize_Static;
+
+			ClassRepNodePolicies.Set(Class, Policy);
+		}
+
+		const EClassRepNodeMapping Policy = GetMappingPolicy(Class);
+		const bool bSpatialize = Policy == EClassRepNodeMapping::Spatialize_Static
+			|| Policy == EClassRepNodeMapping::Spatialize_Dynamic
+			|| Policy == EClassRepNodeMapping::Spatialize_Dormancy;
+
+		InitClassReplicationInfo(Class, bSpatialize);
+	}
+
+	ABlasterCharacter::NotifyEquipWeapon.AddUObject(this, &UBlasterReplicationGraph::OnCharacterEquipWeapon);
+	ABlasterCharacter::NotifyUnEquipWeapon.AddUObject(this, &UBlasterReplicationGraph::OnCharacterUnEquipWeapon);
+}
+
+void UBlasterReplicationGraph::InitClassReplicationInfo(UClass* Class, bool bSpatialize)
+{
+	const AActor* ActorCDO = GetDefault<AActor>(Class);
+	const float ServerMaxTickRate = NetDriver ? NetDriver->GetNetServerMaxTickRate() : 30.f;
+
+	FClassReplicationInfo ClassInfo;
+	ClassInfo.ReplicationPeriodFrame = FMath::Max<uint32>(FMath::RoundToInt(ServerMaxTickRate / ActorCDO->NetUpdateFrequency), 1);
+
+	// Only the grid culls by distance, everything else is relevant at any distance
+	if (bSpatialize)
+		ClassInfo.SetCullDistanceSquared(ActorCDO->NetCullDistanceSquared);
+
+	GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+}
+
+void UBlasterReplicationGraph::InitGlobalGraphNodes()
+{
+	Super::InitGlobalGraphNodes();
+
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = FVector2D(SpatialBiasX, SpatialBiasY);
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+}
+
+void UBlasterReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// Always gathers the connection's own controller, pawn and view target
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantForConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantForConnectionNode, RepGraphConnection);
+}
+
+EClassRepNodeMapping UBlasterReplicationGraph::GetMappingPolicy(UClass* Class) const
+{
+	const EClassRepNodeMapping* Policy = ClassRepNodePolicies.Get(Class);
+	return Policy ? *Policy : EClassRepNodeMapping::NotRouted;
+}
+
+void UBlasterReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+void UBlasterReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	// An equipped weapon was already taken out of the grid, it only has to be detached from its owner
+	AActor* Holder = nullptr;
+	if (EquippedWeapons.RemoveAndCopyValue(ActorInfo.Actor, Holder))
+	{
+		GlobalActorReplicationInfoMap.RemoveDependentActor(Holder, ActorInfo.Actor);
+		return;
+	}
+
+	// A holder that goes away without letting go first leaves its weapon lying where it was
+	for (TMap<AActor*, AActor*>::TIterator It = EquippedWeapons.CreateIterator(); It; ++It)
+	{
+		if (It->Value != ActorInfo.Actor)
+			continue;
+
+		AActor* Weapon = It->Key;
+		It.RemoveCurrent();
+		GlobalActorReplicationInfoMap.RemoveDependentActor(ActorInfo.Actor, Weapon);
+		if (IsValid(Weapon) && !Weapon->IsActorBeingDestroyed())
+			GridNode->AddActor_Dormancy(FNewReplicatedActorInfo(Weapon), GlobalActorReplicationInfoMap.Get(Weapon));
+	}
+
+	switch (GetMappingPolicy(ActorInfo.Class))
+	{
+	case EClassRepNodeMapping::RelevantAllConnections:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		break;
+	case EClassRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+void UBlasterReplicationGraph::OnCharacterEquipWeapon(ABlasterCharacter* Character, AWeapon* Weapon)
+{
+	if (!Character || !Weapon || Character->GetWorld() != GetWorld() || EquippedWeapons.Contains(Weapon))
+		return;
+
+	// The weapon stops being considered on its own and replicates whenever its owner does
+	GridNode->RemoveActor_Dormancy(FNewReplicatedActorInfo(Weapon));
+	GlobalActorReplicationInfoMap.AddDependentActor(Character, Weapon);
+	EquippedWeapons.Add(Weapon, Character);
+}
+
+void UBlasterReplicationGraph::OnCharacterUnEquipWeapon(ABlasterCharacter* Character, AWeapon* Weapon)
+{
+	if (!Character || !Weapon || Character->GetWorld() != GetWorld() || EquippedWeapons.FindRef(Weapon) != Character)
+		return;
+
+	GlobalActorReplicationInfoMap.RemoveDependentActor(Character, Weapon);
+	EquippedWeapons.Remove(Weapon);
+
+	const FNewReplicatedActorInfo ActorInfo(Weapon);
+	GridNode->AddActor_Dormancy(ActorInfo, GlobalActorReplicationInfoMap.Get(Weapon));
+}
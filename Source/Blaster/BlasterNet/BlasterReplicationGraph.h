@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "BlasterReplicationGraph.generated.h"
+
+class ABlasterCharacter;
+class AWeapon;
+
+enum class EClassRepNodeMapping : uint32
+{
+	NotRouted,               // Not added to a global node, e.g. gathered by the per-connection node
+	RelevantAllConnections,  // Always relevant, e.g. game state and player states
+	Spatialize_Static,       // Placed in the grid once and never moves
+	Spatialize_Dynamic,      // Moves around, cell is updated every frame
+	Spatialize_Dormancy,     // Static while dormant, dynamic while awake
+};
+
+/**
+ * Replaces the net driver's relevancy walk over every actor for every connection.
+ *
+ * Characters and weapons lying around are spatialized in a 2D grid, game state and player states
+ * go to a node that is relevant to everyone, and each connection gets a node that always gathers
+ * its own controller, pawn and view target. An equipped weapon leaves the grid and becomes a
+ * dependent of the character holding it, so it only replicates when its owner does.
+ */
+UCLASS(Transient, Config = Engine)
+class BLASTER_API UBlasterReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+private:
+	EClassRepNodeMapping GetMappingPolicy(UClass* Class) const;
+	void InitClassReplicationInfo(UClass* Class, bool bSpatialize);
+
+	void OnCharacterEquipWeapon(ABlasterCharacter* Character, AWeapon* Weapon);
+	void OnCharacterUnEquipWeapon(ABlasterCharacter* Character, AWeapon* Weapon);
+
+	UPROPERTY(Config)
+	float GridCellSize = 10000.f;
+
+	UPROPERTY(Config)
+	float SpatialBiasX = -150000.f;
+
+	UPROPERTY(Config)
+	float SpatialBiasY = -200000.f;
+
+	TClassMap<EClassRepNodeMapping> ClassRepNodePolicies;
+
+	// Weapons taken out of the grid while they are held by a character, mapped to their holder
+	TMap<AActor*, AActor*> EquippedWeapons;
+};
@@ -0,0 +1,180 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterBotSubsystem.h"
+#include "Blaster/Blaster.h"
+#include "Blaster/BlasterComponents/BlasterBotComponent.h"
+#include "Blaster/BlasterSubsystems/BlasterTelemetrySubsystem.h"
+#include "Blaster/Bots/BlasterBotController.h"
+#include "CoreGlobals.h"
+#include "Engine/GameInstance.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+
+DECLARE_CYCLE_STAT(TEXT("Bot Subsystem"), STAT_BlasterBotSubsystem, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Server Bots"), STAT_BlasterServerBots, STATGROUP_Blaster);
+
+static void SpawnBots(const TArray<FString>& Args, UWorld* World)
+{
+	UBlasterBotSubsystem* BotSubsystem = World ? World->GetSubsystem<UBlasterBotSubsystem>() : nullptr;
+	if (BotSubsystem)
+		BotSubsystem->SpawnServerBots(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1);
+}
+
+static FAutoConsoleCommandWithWorldAndArgs SpawnBotsCommand(
+	TEXT("Blaster.SpawnBots"),
+	TEXT("Spawns the given number of server side bots (default 1)"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&SpawnBots));
+
+bool UBlasterBotSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UBlasterBotSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBlasterBotSubsystem, STATGROUP_Tickables);
+}
+
+void UBlasterBotSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (InWorld.GetNetMode() == NM_Client)
+	{
+		bClientBot = FParse::Param(FCommandLine::Get(), TEXT("BlasterBot"));
+		return;
+	}
+
+	FParse::Value(FCommandLine::Get(), TEXT("BlasterStatsInterval="), StatsInterval);
+
+	int32 NumBots = 0;
+	if (FParse::Value(FCommandLine::Get(), TEXT("BlasterServerBots="), NumBots))
+		SpawnServerBots(NumBots);
+}
+
+void UBlasterBotSubsystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_BlasterServerBots, ServerBots.Num());
+	ServerBots.Reset();
+
+	Super::Deinitialize();
+}
+
+void UBlasterBotSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterBotSubsystem);
+
+	// The local player controller only shows up once the server has replicated it
+	if (bClientBot && !bClientBotAttached)
+		AttachClientBot();
+
+	if (StatsInterval > 0.f)
+	{
+		SampleServerStats();
+
+		TimeSinceStats += DeltaTime;
+		if (TimeSinceStats >= StatsInterval && NumFrames > 0)
+		{
+			const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+			const int32 NumClients = NetDriver ? NetDriver->ClientConnections.Num() : 0;
+			const uint32 OutBytesPerSecond = NetDriver ? NetDriver->OutBytesPerSecond : 0u;
+			const uint32 InBytesPerSecond = NetDriver ? NetDriver->InBytesPerSecond : 0u;
+			UE_LOG(LogBlaster, Display, TEXT("LoadTest: clients=%d bots=%d frame_avg_ms=%.2f frame_max_ms=%.2f net_dispatch_avg_ms=%.2f net_flush_avg_ms=%.2f net_max_ms=%.2f out_Bps=%u in_Bps=%u conn_out_avg_Bps=%u conn_in_avg_Bps=%u conn_out_max_Bps=%u"),
+				NumClients,
+				ServerBots.Num(),
+				GameThreadTimeSum / NumFrames,
+				GameThreadTimeMax,
+				NetDispatchTimeSum / NumFrames,
+				NetFlushTimeSum / NumFrames,
+				NetTimeMax,
+				OutBytesPerSecond,
+				InBytesPerSecond,
+				NumClients > 0 ? OutBytesPerSecond / NumClients : 0u,
+				NumClients > 0 ? InBytesPerSecond / NumClients : 0u,
+				ConnectionOutBytesMax);
+
+			TimeSinceStats = 0.f;
+			GameThreadTimeSum = 0.0;
+			GameThreadTimeMax = 0.0;
+			NetDispatchTimeSum = 0.0;
+			NetFlushTimeSum = 0.0;
+			NetTimeMax = 0.0;
+			ConnectionOutBytesMax = 0;
+			NumFrames = 0;
+		}
+	}
+}
+
+void UBlasterBotSubsystem::SampleServerStats()
+{
+	// Time the game thread spent working last frame, without the wait for the next server tick
+	const double GameThreadTime = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	GameThreadTimeSum += GameThreadTime;
+	GameThreadTimeMax = FMath::Max(GameThreadTimeMax, GameThreadTime);
+	++NumFrames;
+
+	// Net driver receive and send time and the busiest connection, as telemetry recorded them
+	const UBlasterTelemetrySubsystem* Telemetry = GetWorld()->GetGameInstance() ? GetWorld()->GetGameInstance()->GetSubsystem<UBlasterTelemetrySubsystem>() : nullptr;
+	if (!Telemetry)
+		return;
+
+	const FBlasterTelemetryFrame& Frame = Telemetry->GetLastFrame();
+	NetDispatchTimeSum += Frame.NetDispatchMs;
+	NetFlushTimeSum += Frame.NetFlushMs;
+	NetTimeMax = FMath::Max(NetTimeMax, static_cast<double>(Frame.NetDispatchMs + Frame.NetFlushMs));
+	ConnectionOutBytesMax = FMath::Max(ConnectionOutBytesMax, Frame.MaxConnectionOutBytesPerSecond);
+}
+
+void UBlasterBotSubsystem::AttachClientBot()
+{
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (!PlayerController)
+		return;
+
+	UBlasterBotComponent* BotComponent = NewObject<UBlasterBotComponent>(PlayerController, TEXT("Bot"));
+	BotComponent->RegisterComponent();
+	bClientBotAttached = true;
+
+	UE_LOG(LogBlaster, Log, TEXT("Bot is playing as %s"), *PlayerController->GetName());
+}
+
+void UBlasterBotSubsystem::SpawnServerBots(int32 Count)
+{
+	AGameModeBase* GameMode = GetWorld()->GetAuthGameMode();
+	if (!GameMode)
+		return;
+
+	FActorSpawnParameters PawnSpawnParams;
+	PawnSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		ABlasterBotController* Bot = GetWorld()->SpawnActor<ABlasterBotController>();
+		if (!Bot)
+			continue;
+
+		// There are far fewer player starts than bots, spread them out around the chosen one
+		const AActor* PlayerStart = GameMode->ChoosePlayerStart(Bot);
+		FTransform SpawnTransform = PlayerStart ? PlayerStart->GetActorTransform() : FTransform::Identity;
+		SpawnTransform.AddToTranslation(FVector(FMath::RandPointInCircle(500.f), 0.f));
+
+		APawn* Pawn = GetWorld()->SpawnActor<APawn>(GameMode->GetDefaultPawnClassForController(Bot), SpawnTransform, PawnSpawnParams);
+		if (!Pawn)
+		{
+			Bot->Destroy();
+			continue;
+		}
+
+		Bot->Possess(Pawn);
+		if (Bot->PlayerState)
+			Bot->PlayerState->SetPlayerName(FString::Printf(TEXT("Bot%d"), ServerBots.Num()));
+
+		ServerBots.Add(Bot);
+		INC_DWORD_STAT(STAT_BlasterServerBots);
+	}
+
+	UE_LOG(LogBlaster, Log, TEXT("%d server bots"), ServerBots.Num());
+}
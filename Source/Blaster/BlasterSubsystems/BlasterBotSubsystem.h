@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BlasterBotSubsystem.generated.h"
+
+class ABlasterBotController;
+
+/**
+ * Load testing support, driven from the command line.
+ *
+ *  -BlasterServerBots=N     the server spawns N ABlasterBotController bots when the world begins play
+ *  -BlasterBot              a client hands its local player controller to a UBlasterBotComponent
+ *  -BlasterStatsInterval=S  the server logs game thread time, net tick time and bandwidth every S seconds
+ *
+ * Scripts/BotLoadTest.sh starts a dedicated server and headless bot clients with these and turns the
+ * logged stats into a CSV. Net tick time and the busiest connection come from UBlasterTelemetrySubsystem,
+ * they read zero with -NoBlasterTelemetry.
+ */
+UCLASS()
+class BLASTER_API UBlasterBotSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void SpawnServerBots(int32 Count);
+
+	FORCEINLINE int32 GetNumServerBots() const { return ServerBots.Num(); }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	void AttachClientBot();
+	void SampleServerStats();
+
+	UPROPERTY()
+	TArray<ABlasterBotController*> ServerBots;
+
+	bool bClientBot = false;
+	bool bClientBotAttached = false;
+
+	float StatsInterval = 0.f;
+	float TimeSinceStats = 0.f;
+	double GameThreadTimeSum = 0.0;
+	double GameThreadTimeMax = 0.0;
+	double NetDispatchTimeSum = 0.0;
+	double NetFlushTimeSum = 0.0;
+	double NetTimeMax = 0.0;
+	uint32 ConnectionOutBytesMax = 0;
+	int32 NumFrames = 0;
+};
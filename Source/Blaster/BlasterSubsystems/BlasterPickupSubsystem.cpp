@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterPickupSubsystem.h"
+#include "BlasterTickSubsystem.h"
+#include "Blaster/Blaster.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/Weapon/Weapon.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SphereComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Pickup Query"), STAT_BlasterPickupQuery, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Candidates Tested"), STAT_BlasterPickupCandidates, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pickups In Grid"), STAT_BlasterPickupsInGrid, STATGROUP_Blaster);
+
+void UBlasterPickupSubsystem::Tick(float DeltaTime)
+{
+	if (!bUsePickupGrid || GetWorld()->GetNetMode() == NM_Client)
+		return;
+
+	AccumulatedTime += DeltaTime;
+	if (AccumulatedTime < UpdateInterval)
+		return;
+
+	AccumulatedTime = 0.f;
+	UpdateOverlappingWeapons();
+}
+
+void UBlasterPickupSubsystem::UpdateOverlappingWeapons()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterPickupQuery);
+
+	UBlasterTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UBlasterTickSubsystem>();
+	if (!TickSubsystem)
+		return;
+
+	for (ABlasterCharacter* Character : TickSubsystem->GetCharacters())
+	{
+		AWeapon* ClosestWeapon = FindClosestWeapon(Character);
+		if (ClosestWeapon != Character->GetOverlappingWeapon())
+			Character->SetOverlappingWeapon(ClosestWeapon);
+	}
+}
+
+TStatId UBlasterPickupSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBlasterPickupSubsystem, STATGROUP_Tickables);
+}
+
+bool UBlasterPickupSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+FIntPoint UBlasterPickupSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void UBlasterPickupSubsystem::UpdateWeapon(AWeapon* Weapon)
+{
+	if (!bUsePickupGrid || !Weapon || !Weapon->GetAreaSphere())
+		return;
+
+	if (Weapon->GetWeaponState() == EWeaponState::EWS_Equipped || Weapon->IsHidden())
+	{
+		RemoveWeapon(Weapon);
+		return;
+	}
+
+	int32 Index = INDEX_NONE;
+	if (const int32* ExistingIndex = PickupIndices.Find(Weapon))
+	{
+		Index = *ExistingIndex;
+		RemoveFromCell(Index);
+	}
+	else
+	{
+		Index = Pickups.Add(Weapon);
+		PickupLocations.AddUninitialized();
+		PickupRadii.AddUninitialized();
+		PickupCells.AddUninitialized();
+		PickupIndices.Add(Weapon, Index);
+		INC_DWORD_STAT(STAT_BlasterPickupsInGrid);
+	}
+
+	const USphereComponent* AreaSphere = Weapon->GetAreaSphere();
+	PickupLocations[Index] = AreaSphere->GetComponentLocation();
+	PickupRadii[Index] = AreaSphere->GetScaledSphereRadius();
+	PickupCells[Index] = GetCell(PickupLocations[Index]);
+	Cells.FindOrAdd(PickupCells[Index]).Add(Index);
+
+	MaxPickupRadius = FMath::Max(MaxPickupRadius, PickupRadii[Index]);
+}
+
+void UBlasterPickupSubsystem::RemoveWeapon(AWeapon* Weapon)
+{
+	int32 Index = INDEX_NONE;
+	if (!PickupIndices.RemoveAndCopyValue(Weapon, Index))
+		return;
+
+	RemoveFromCell(Index);
+
+	// The last pickup moves into the freed slot, so its cell has to point at the new index
+	const int32 LastIndex = Pickups.Num() - 1;
+	if (Index != LastIndex)
+	{
+		TArray<int32>& LastCell = Cells.FindChecked(PickupCells[LastIndex]);
+		LastCell[LastCell.Find(LastIndex)] = Index;
+		PickupIndices.FindChecked(Pickups[LastIndex]) = Index;
+	}
+
+	Pickups.RemoveAtSwap(Index);
+	PickupLocations.RemoveAtSwap(Index);
+	PickupRadii.RemoveAtSwap(Index);
+	PickupCells.RemoveAtSwap(Index);
+	DEC_DWORD_STAT(STAT_BlasterPickupsInGrid);
+}
+
+void UBlasterPickupSubsystem::RemoveFromCell(int32 Index)
+{
+	TArray<int32>* Cell = Cells.Find(PickupCells[Index]);
+	if (!Cell)
+		return;
+
+	Cell->RemoveSingleSwap(Index);
+	if (Cell->Num() == 0)
+		Cells.Remove(PickupCells[Index]);
+}
+
+AWeapon* UBlasterPickupSubsystem::FindClosestWeapon(const ABlasterCharacter* Character) const
+{
+	const UCapsuleComponent* Capsule = Character ? Character->GetCapsuleComponent() : nullptr;
+	if (!Capsule || Pickups.Num() == 0)
+		return nullptr;
+
+	const FVector Location = Capsule->GetComponentLocation();
+	const FVector AxisOffset(0.f, 0.f, Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere());
+	const float CapsuleRadius = Capsule->GetScaledCapsuleRadius();
+	const float SearchRadius = MaxPickupRadius + CapsuleRadius;
+
+	const FIntPoint MinCell = GetCell(Location - FVector(SearchRadius, SearchRadius, 0.f));
+	const FIntPoint MaxCell = GetCell(Location + FVector(SearchRadius, SearchRadius, 0.f));
+
+	int32 ClosestIndex = INDEX_NONE;
+	float ClosestDistanceSquared = 0.f;
+	uint32 NumTested = 0;
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			const TArray<int32>* Cell = Cells.Find(FIntPoint(X, Y));
+			if (!Cell)
+				continue;
+
+			for (const int32 Index : *Cell)
+			{
+				++NumTested;
+
+				// Same test as the sphere overlapping the capsule
+				const float DistanceSquared = static_cast<float>(FMath::PointDistToSegmentSquared(PickupLocations[Index], Location - AxisOffset, Location + AxisOffset));
+				if (DistanceSquared > FMath::Square(PickupRadii[Index] + CapsuleRadius))
+					continue;
+
+				const bool bCloser = ClosestIndex == INDEX_NONE
+					|| DistanceSquared < ClosestDistanceSquared
+					|| (DistanceSquared == ClosestDistanceSquared && Pickups[Index]->GetUniqueID() < Pickups[ClosestIndex]->GetUniqueID());
+
+				if (bCloser)
+				{
+					ClosestIndex = Index;
+					ClosestDistanceSquared = DistanceSquared;
+				}
+			}
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_BlasterPickupCandidates, NumTested);
+
+	return ClosestIndex != INDEX_NONE ? Pickups[ClosestIndex] : nullptr;
+}
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BlasterPickupSubsystem.generated.h"
+
+class ABlasterCharacter;
+class AWeapon;
+
+/**
+ * Optional server side replacement for the weapon AreaSphere overlap events.
+ *
+ * Weapons lying around are kept in a uniform 2D grid and, at a fixed rate, every character gets the
+ * closest weapon whose pickup sphere touches its capsule as its overlapping weapon. Ties go to the
+ * weapon with the lower unique id, so the result does not depend on event or iteration order.
+ */
+UCLASS(Config = Game)
+class BLASTER_API UBlasterPickupSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Adds, moves or removes the weapon depending on whether it can currently be picked up
+	void UpdateWeapon(AWeapon* Weapon);
+	void RemoveWeapon(AWeapon* Weapon);
+
+	AWeapon* FindClosestWeapon(const ABlasterCharacter* Character) const;
+
+	// One grid pass, gives every character its closest weapon; Tick runs it every UpdateInterval
+	void UpdateOverlappingWeapons();
+
+	FORCEINLINE bool IsGridEnabled() const { return bUsePickupGrid; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	FIntPoint GetCell(const FVector& Location) const;
+	void RemoveFromCell(int32 Index);
+
+	UPROPERTY(Config)
+	bool bUsePickupGrid = false;
+
+	UPROPERTY(Config)
+	float CellSize = 1000.f;
+
+	UPROPERTY(Config)
+	float UpdateInterval = 0.1f;
+
+	UPROPERTY()
+	TArray<AWeapon*> Pickups;
+
+	// Parallel to Pickups
+	TArray<FVector> PickupLocations;
+	TArray<float> PickupRadii;
+	TArray<FIntPoint> PickupCells;
+
+	TMap<AWeapon*, int32> PickupIndices;
+
+	// Indices into Pickups per grid cell
+	TMap<FIntPoint, TArray<int32>> Cells;
+
+	// Largest pickup radius seen so far, bounds the cells a query has to look at
+	float MaxPickupRadius = 0.f;
+
+	float AccumulatedTime = 0.f;
+};
@@ -0,0 +1,262 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterProjectileSubsystem.h"
+#include "BlasterTickSubsystem.h"
+#include "Blaster/Blaster.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/Weapon/Weapon.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "GameFramework/DamageType.h"
+#include "GameFramework/GameStateBase.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Sweep"), STAT_BlasterProjectileSweep, STATGROUP_BlasterCombat);
+DECLARE_CYCLE_STAT(TEXT("Projectile Resolve"), STAT_BlasterProjectileResolve, STATGROUP_BlasterCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live Projectiles"), STAT_BlasterLiveProjectiles, STATGROUP_BlasterCombat);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile Hits"), STAT_BlasterProjectileHits, STATGROUP_BlasterCombat);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles Dropped"), STAT_BlasterProjectilesDropped, STATGROUP_BlasterCombat);
+
+static void ProjectileStress(const TArray<FString>& Args, UWorld* World)
+{
+	UBlasterProjectileSubsystem* Projectiles = World ? World->GetSubsystem<UBlasterProjectileSubsystem>() : nullptr;
+	if (!Projectiles || World->GetNetMode() == NM_Client)
+		return;
+
+	const int32 Count = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000;
+
+	FBlasterProjectileParams Params;
+	Params.Lifetime = Args.Num() > 1 ? FCString::Atof(*Args[1]) : 10.f;
+
+	// Fanned out from the characters so the shots cross the parts of the level that are in use
+	UBlasterTickSubsystem* TickSubsystem = World->GetSubsystem<UBlasterTickSubsystem>();
+	const TArray<ABlasterCharacter*> NoCharacters;
+	const TArray<ABlasterCharacter*>& Characters = TickSubsystem ? TickSubsystem->GetCharacters() : NoCharacters;
+
+	FRandomStream Random(FPlatformTime::Cycles());
+	int32 NumSpawned = 0;
+	for (; NumSpawned < Count; ++NumSpawned)
+	{
+		const FVector Center = Characters.Num() > 0 ? Characters[NumSpawned % Characters.Num()]->GetActorLocation() : FVector(0.f, 0.f, 200.f);
+		const FVector Direction = FRotator(Random.FRandRange(-5.f, 15.f), Random.FRandRange(0.f, 360.f), 0.f).Vector();
+
+		const FBlasterProjectileSpawn Spawn = FBlasterProjectileSpawn::Make(Center + Direction * 100.f, Direction, Random.RandHelper(MAX_int32), World->GetTimeSeconds());
+		if (!Projectiles->SpawnProjectile(Spawn, Params, nullptr))
+			break;
+	}
+
+	UE_LOG(LogBlaster, Display, TEXT("Spawned %d stress projectiles, %d in flight"), NumSpawned, Projectiles->GetNumProjectiles());
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ProjectileStressCommand(
+	TEXT("Blaster.ProjectileStress"),
+	TEXT("Server only, spawns Count projectiles (default 1000) without damage that live for Lifetime seconds (default 10). Watch stat BlasterCombat"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ProjectileStress));
+
+FBlasterProjectileSpawn FBlasterProjectileSpawn::Make(const FVector& Origin, const FVector& Direction, int32 Seed, double SpawnTime)
+{
+	FBlasterProjectileSpawn Spawn;
+
+	// Rounded the way FVector_NetQuantize sends it
+	Spawn.Origin = FVector(FMath::RoundToDouble(Origin.X), FMath::RoundToDouble(Origin.Y), FMath::RoundToDouble(Origin.Z));
+
+	const FRotator Rotation = Direction.Rotation();
+	Spawn.Pitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+	Spawn.Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+	Spawn.Seed = Seed;
+	Spawn.SpawnTime = SpawnTime;
+	return Spawn;
+}
+
+FVector FBlasterProjectileSpawn::GetDirection(float SpreadDegrees) const
+{
+	const FVector Direction = FRotator(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), 0.f).Vector();
+	if (SpreadDegrees <= 0.f)
+		return Direction;
+
+	const FRandomStream Random(Seed);
+	return Random.VRandCone(Direction, FMath::DegreesToRadians(SpreadDegrees));
+}
+
+void UBlasterProjectileSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Sized once, spawning and removing projectiles only ever moves elements around
+	MaxProjectiles = FMath::Max(MaxProjectiles, 1);
+	Origins.SetNumUninitialized(MaxProjectiles);
+	Velocities.SetNumUninitialized(MaxProjectiles);
+	GravityZs.SetNumUninitialized(MaxProjectiles);
+	Radii.SetNumUninitialized(MaxProjectiles);
+	Ages.SetNumUninitialized(MaxProjectiles);
+	Lifetimes.SetNumUninitialized(MaxProjectiles);
+	IgnoredActorIds.SetNumUninitialized(MaxProjectiles);
+	Causers.SetNum(MaxProjectiles);
+	States.SetNumUninitialized(MaxProjectiles);
+	HitLocations.SetNumUninitialized(MaxProjectiles);
+	HitActors.SetNumUninitialized(MaxProjectiles);
+}
+
+void UBlasterProjectileSubsystem::Tick(float DeltaTime)
+{
+	Simulate(DeltaTime);
+}
+
+TStatId UBlasterProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBlasterProjectileSubsystem, STATGROUP_Tickables);
+}
+
+bool UBlasterProjectileSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UBlasterProjectileSubsystem::SpawnProjectile(const FBlasterProjectileSpawn& Spawn, const FBlasterProjectileParams& Params, AWeapon* Causer)
+{
+	const AActor* Shooter = Causer ? Causer->GetOwner() : nullptr;
+	if (NumProjectiles >= MaxProjectiles || !CanShooterSpawn(Shooter))
+	{
+		INC_DWORD_STAT(STAT_BlasterProjectilesDropped);
+		return false;
+	}
+
+	const int32 Index = NumProjectiles++;
+	Origins[Index] = Spawn.Origin;
+	Velocities[Index] = Spawn.GetDirection(Params.SpreadDegrees) * Params.Speed;
+	GravityZs[Index] = GetWorld()->GetGravityZ() * Params.GravityScale;
+	Radii[Index] = Params.Radius;
+	Lifetimes[Index] = Params.Lifetime;
+	Ages[Index] = 0.f;
+
+	// Clients pick the shot up where the server's copy is by now, skipping the part already flown is only cosmetic
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	if (GetWorld()->GetNetMode() == NM_Client && GameState)
+		Ages[Index] = FMath::Clamp(static_cast<float>(GameState->GetServerWorldTimeSeconds() - Spawn.SpawnTime), 0.f, MaxCatchUpTime);
+
+	IgnoredActorIds[Index] = Shooter ? Shooter->GetUniqueID() : 0;
+	Causers[Index] = Causer;
+	if (Shooter)
+		++NumProjectilesByShooter.FindOrAdd(IgnoredActorIds[Index]);
+
+	SET_DWORD_STAT(STAT_BlasterLiveProjectiles, NumProjectiles);
+	return true;
+}
+
+bool UBlasterProjectileSubsystem::CanShooterSpawn(const AActor* Shooter) const
+{
+	if (!Shooter || MaxProjectilesPerShooter <= 0)
+		return true;
+
+	const int32* NumShooterProjectiles = NumProjectilesByShooter.Find(Shooter->GetUniqueID());
+	return !NumShooterProjectiles || *NumShooterProjectiles < MaxProjectilesPerShooter;
+}
+
+FVector UBlasterProjectileSubsystem::GetPosition(int32 Index, float Age) const
+{
+	return Origins[Index] + Velocities[Index] * Age + FVector(0.f, 0.f, 0.5f * GravityZs[Index] * Age * Age);
+}
+
+void UBlasterProjectileSubsystem::Simulate(float DeltaTime)
+{
+	if (NumProjectiles == 0)
+		return;
+
+	UWorld* World = GetWorld();
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BlasterProjectileSweep);
+
+		// Every task only touches its own indices, scene queries are safe off the game thread
+		ParallelFor(TEXT("BlasterProjectileSweep"), NumProjectiles, FMath::Max(MinBatchSize, 1), [this, World, DeltaTime](int32 Index)
+		{
+			SweepProjectile(World, Index, DeltaTime);
+		});
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_BlasterProjectileResolve);
+
+	// Backwards, so the projectile moved into a removed slot has already been looked at
+	const bool bAuthority = World->GetNetMode() != NM_Client;
+	for (int32 Index = NumProjectiles - 1; Index >= 0; --Index)
+	{
+		if (States[Index] == ProjectileState_Flying)
+			continue;
+
+		if (States[Index] == ProjectileState_Hit)
+		{
+			AWeapon* Causer = Causers[Index].Get();
+			AActor* HitActor = IsValid(HitActors[Index]) ? HitActors[Index] : nullptr;
+			OnProjectileImpact.Broadcast(HitLocations[Index], HitActor, Causer);
+
+			if (bAuthority && Causer && HitActor)
+			{
+				const APawn* Shooter = Cast<APawn>(Causer->GetOwner());
+				UGameplayStatics::ApplyDamage(HitActor, Causer->GetDamage(), Shooter ? Shooter->GetController() : nullptr, Causer, UDamageType::StaticClass());
+			}
+
+			INC_DWORD_STAT(STAT_BlasterProjectileHits);
+		}
+
+		RemoveProjectile(Index);
+	}
+
+	SET_DWORD_STAT(STAT_BlasterLiveProjectiles, NumProjectiles);
+}
+
+void UBlasterProjectileSubsystem::SweepProjectile(UWorld* World, int32 Index, float DeltaTime)
+{
+	const float Age = Ages[Index];
+	const float NewAge = FMath::Min(Age + DeltaTime, Lifetimes[Index]);
+	const FVector Start = GetPosition(Index, Age);
+	const FVector End = GetPosition(Index, NewAge);
+	Ages[Index] = NewAge;
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(BlasterProjectile), false);
+	if (IgnoredActorIds[Index] != 0)
+		QueryParams.AddIgnoredActor(IgnoredActorIds[Index]);
+
+	FHitResult Hit;
+	const bool bHit = Radii[Index] > 0.f
+		? World->SweepSingleByChannel(Hit, Start, End, FQuat::Identity, ECollisionChannel::ECC_Visibility, FCollisionShape::MakeSphere(Radii[Index]), QueryParams)
+		: World->LineTraceSingleByChannel(Hit, Start, End, ECollisionChannel::ECC_Visibility, QueryParams);
+
+	if (bHit)
+	{
+		States[Index] = ProjectileState_Hit;
+		HitLocations[Index] = Hit.ImpactPoint;
+		HitActors[Index] = Hit.GetActor();
+	}
+	else
+	{
+		States[Index] = NewAge >= Lifetimes[Index] ? ProjectileState_Expired : ProjectileState_Flying;
+	}
+}
+
+void UBlasterProjectileSubsystem::RemoveProjectile(int32 Index)
+{
+	if (IgnoredActorIds[Index] != 0)
+	{
+		int32& NumShooterProjectiles = NumProjectilesByShooter.FindChecked(IgnoredActorIds[Index]);
+		if (--NumShooterProjectiles == 0)
+			NumProjectilesByShooter.Remove(IgnoredActorIds[Index]);
+	}
+
+	const int32 Last = --NumProjectiles;
+	if (Index == Last)
+	{
+		Causers[Last].Reset();
+		return;
+	}
+
+	Origins[Index] = Origins[Last];
+	Velocities[Index] = Velocities[Last];
+	GravityZs[Index] = GravityZs[Last];
+	Radii[Index] = Radii[Last];
+	Ages[Index] = Ages[Last];
+	Lifetimes[Index] = Lifetimes[Last];
+	IgnoredActorIds[Index] = IgnoredActorIds[Last];
+	Causers[Index] = Causers[Last];
+	Causers[Last].Reset();
+}
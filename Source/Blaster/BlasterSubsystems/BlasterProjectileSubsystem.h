@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/NetSerialization.h"
+#include "BlasterProjectileSubsystem.generated.h"
+
+class AWeapon;
+
+// How a projectile weapon's shots fly, set on AProjectileWeapon
+USTRUCT(BlueprintType)
+struct FBlasterProjectileParams
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float Speed = 8000.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float GravityScale = 0.f;
+
+	// Sphere swept along the path, 0 is a line
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float Radius = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float Lifetime = 3.f;
+
+	// Half angle of the cone the seed picks the direction from
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float SpreadDegrees = 0.f;
+};
+
+/**
+ * Everything a client needs to fly a shot the same way the server does. Only this is replicated,
+ * the path is a function of it and the projectile's age.
+ *
+ * Origin and direction are quantized by the server before it simulates, so both ends start from
+ * the same values.
+ */
+USTRUCT()
+struct FBlasterProjectileSpawn
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	uint16 Pitch = 0;
+
+	UPROPERTY()
+	uint16 Yaw = 0;
+
+	UPROPERTY()
+	int32 Seed = 0;
+
+	// Server world time of the shot, clients fast forward by their lag up to MaxCatchUpTime
+	UPROPERTY()
+	double SpawnTime = 0.0;
+
+	static FBlasterProjectileSpawn Make(const FVector& Origin, const FVector& Direction, int32 Seed, double SpawnTime);
+
+	FVector GetDirection(float SpreadDegrees) const;
+};
+
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FBlasterProjectileImpactSignature, const FVector& /*Location*/, AActor* /*HitActor*/, AWeapon* /*Causer*/);
+
+/**
+ * Flies every projectile in the world without an actor per shot.
+ *
+ * Live projectiles are kept in parallel arrays allocated once for MaxProjectiles, packed at the
+ * front; a finished one is replaced by the last. Each tick sweeps all of them along their ballistic
+ * path in one ParallelFor pass, then impacts and expiries are resolved on the game thread, where
+ * the server also applies damage.
+ */
+UCLASS(Config = Game)
+class BLASTER_API UBlasterProjectileSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// False when MaxProjectiles are already in flight or the causer's owner has MaxProjectilesPerShooter of them, Causer may be null
+	bool SpawnProjectile(const FBlasterProjectileSpawn& Spawn, const FBlasterProjectileParams& Params, AWeapon* Causer);
+
+	// False when Shooter already has MaxProjectilesPerShooter in flight, the server asks before multicasting a shot
+	bool CanShooterSpawn(const AActor* Shooter) const;
+
+	// Advances every projectile by DeltaTime and resolves the ones that hit or expired
+	void Simulate(float DeltaTime);
+
+	FORCEINLINE int32 GetNumProjectiles() const { return NumProjectiles; }
+	FORCEINLINE int32 GetMaxProjectiles() const { return MaxProjectiles; }
+
+	// Cosmetic, on every machine
+	FBlasterProjectileImpactSignature OnProjectileImpact;
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	FVector GetPosition(int32 Index, float Age) const;
+	void SweepProjectile(UWorld* World, int32 Index, float DeltaTime);
+	void RemoveProjectile(int32 Index);
+
+	UPROPERTY(Config)
+	int32 MaxProjectiles = 16384;
+
+	// Keeps one client from filling the pool for everyone, 0 is no limit
+	UPROPERTY(Config)
+	int32 MaxProjectilesPerShooter = 64;
+
+	// Projectiles per ParallelFor task
+	UPROPERTY(Config)
+	int32 MinBatchSize = 64;
+
+	UPROPERTY(Config)
+	float MaxCatchUpTime = 0.25f;
+
+	int32 NumProjectiles = 0;
+
+	// Live projectiles by IgnoredActorIds, shooters without any have no entry
+	TMap<uint32, int32> NumProjectilesByShooter;
+
+	enum EProjectileState : uint8 { ProjectileState_Flying, ProjectileState_Hit, ProjectileState_Expired };
+
+	//
+	// Per projectile, NumProjectiles used out of MaxProjectiles
+	//
+	TArray<FVector> Origins;
+	TArray<FVector> Velocities;
+	TArray<float> GravityZs;
+	TArray<float> Radii;
+	TArray<float> Ages;
+	TArray<float> Lifetimes;
+	TArray<uint32> IgnoredActorIds;
+	TArray<TWeakObjectPtr<AWeapon>> Causers;
+
+	//
+	// Written by the sweep pass, only meaningful until the end of the tick
+	//
+	TArray<uint8> States;
+	TArray<FVector> HitLocations;
+	TArray<AActor*> HitActors;
+};
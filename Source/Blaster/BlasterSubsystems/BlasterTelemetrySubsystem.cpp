@@ -0,0 +1,266 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterTelemetrySubsystem.h"
+#include "Blaster/Blaster.h"
+#include "Blaster/BlasterSubsystems/BlasterTickSubsystem.h"
+#include "Async/Async.h"
+#include "CoreGlobals.h"
+#include "Engine/GameInstance.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+DECLARE_CYCLE_STAT(TEXT("Telemetry Sample"), STAT_BlasterTelemetrySample, STATGROUP_Blaster);
+DECLARE_CYCLE_STAT(TEXT("Telemetry Write"), STAT_BlasterTelemetryWrite, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Telemetry Frames Dropped"), STAT_BlasterTelemetryFramesDropped, STATGROUP_Blaster);
+
+static const TCHAR* const TelemetryRpcNames[] = { TEXT("CombatInput"), TEXT("EquipWeapon"), TEXT("Fire"), TEXT("ScoreRequest") };
+static_assert(UE_ARRAY_COUNT(TelemetryRpcNames) == static_cast<int32>(EBlasterTelemetryRpc::MAX), "Every telemetry RPC needs a name");
+
+void UBlasterTelemetrySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("NoBlasterTelemetry")))
+		bEnabled = false;
+
+	if (!bEnabled || IsRunningCommandlet())
+		return;
+
+	Frames = MakeUnique<TBlasterSpscRing<FBlasterTelemetryFrame, RingCapacity>>();
+
+	const FString BaseName = FPaths::ProjectSavedDir() / TEXT("Telemetry") / FString::Printf(TEXT("Server-%s-%u"),
+		*FDateTime::Now().ToString(), FPlatformProcess::GetCurrentProcessId());
+	CsvPath = BaseName + TEXT(".csv");
+	JsonPath = BaseName + TEXT(".jsonl");
+	ConnectionsPath = BaseName + TEXT("-Connections.csv");
+
+	FWorldDelegates::OnWorldTickStart.AddUObject(this, &UBlasterTelemetrySubsystem::OnWorldTickStart);
+	FWorldDelegates::OnWorldPreActorTick.AddUObject(this, &UBlasterTelemetrySubsystem::OnWorldPreActorTick);
+	FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UBlasterTelemetrySubsystem::OnWorldPostActorTick);
+}
+
+void UBlasterTelemetrySubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldTickStart.RemoveAll(this);
+	FWorldDelegates::OnWorldPreActorTick.RemoveAll(this);
+	FWorldDelegates::OnWorldPostActorTick.RemoveAll(this);
+	TrackWorld(nullptr);
+
+	if (Frames)
+	{
+		if (FlushTask.IsValid())
+			FlushTask.Wait();
+
+		WriteFrames(TArray<FBlasterTelemetryConnection>(), FPlatformTime::Seconds());
+		Frames.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+TStatId UBlasterTelemetrySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBlasterTelemetrySubsystem, STATGROUP_Tickables);
+}
+
+ETickableTickType UBlasterTelemetrySubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UBlasterTelemetrySubsystem::IsTickable() const
+{
+	return Frames.IsValid();
+}
+
+void UBlasterTelemetrySubsystem::TrackWorld(UWorld* World)
+{
+	if (TrackedWorld.Get() == World)
+		return;
+
+	if (UWorld* OldWorld = TrackedWorld.Get())
+		OldWorld->PostTickFlushEvent.Remove(PostTickFlushHandle);
+
+	TrackedWorld = World;
+	PostTickFlushHandle.Reset();
+
+	if (World)
+		PostTickFlushHandle = World->PostTickFlushEvent.AddUObject(this, &UBlasterTelemetrySubsystem::OnPostTickFlush);
+}
+
+//
+// The net driver receives right after the world tick starts and sends after the actors have ticked,
+// the time between these delegates is mostly spent in it
+//
+
+void UBlasterTelemetrySubsystem::OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaTime)
+{
+	if (World == TrackedWorld.Get())
+		TickStartCycles = FPlatformTime::Cycles64();
+}
+
+void UBlasterTelemetrySubsystem::OnWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaTime)
+{
+	if (World == TrackedWorld.Get())
+		NetDispatchCycles = FPlatformTime::Cycles64() - TickStartCycles;
+}
+
+void UBlasterTelemetrySubsystem::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaTime)
+{
+	if (World == TrackedWorld.Get())
+		PostActorTickCycles = FPlatformTime::Cycles64();
+}
+
+void UBlasterTelemetrySubsystem::OnPostTickFlush()
+{
+	NetFlushCycles = FPlatformTime::Cycles64() - PostActorTickCycles;
+}
+
+void UBlasterTelemetrySubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterTelemetrySample);
+
+	UWorld* World = GetGameInstance()->GetWorld();
+	TrackWorld(World);
+
+	if (!World || (World->GetNetMode() != NM_DedicatedServer && World->GetNetMode() != NM_ListenServer))
+		return;
+
+	FBlasterTelemetryFrame Frame;
+	Frame.FrameNumber = GFrameCounter;
+	Frame.Time = World->GetRealTimeSeconds();
+	Frame.GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	Frame.NetDispatchMs = FPlatformTime::ToMilliseconds64(NetDispatchCycles);
+	Frame.NetFlushMs = FPlatformTime::ToMilliseconds64(NetFlushCycles);
+
+	if (const AGameStateBase* GameState = World->GetGameState())
+		Frame.NumPlayers = GameState->PlayerArray.Num();
+
+	if (const UBlasterTickSubsystem* TickSubsystem = World->GetSubsystem<UBlasterTickSubsystem>())
+	{
+		Frame.NumCharacters = TickSubsystem->GetNumCharacters();
+		Frame.NumWeapons = TickSubsystem->GetNumWeapons();
+	}
+
+	if (const UNetDriver* NetDriver = World->GetNetDriver())
+	{
+		Frame.NumConnections = NetDriver->ClientConnections.Num();
+		Frame.OutBytesPerSecond = NetDriver->OutBytesPerSecond;
+		for (const UNetConnection* Connection : NetDriver->ClientConnections)
+			Frame.MaxConnectionOutBytesPerSecond = FMath::Max(Frame.MaxConnectionOutBytesPerSecond, Connection->OutBytesPerSecond);
+	}
+
+	FMemory::Memcpy(Frame.RpcCounts, PendingRpcCounts, sizeof(PendingRpcCounts));
+	FMemory::Memzero(PendingRpcCounts);
+
+	LastFrame = Frame;
+	if (!Frames->Push(Frame))
+		INC_DWORD_STAT(STAT_BlasterTelemetryFramesDropped);
+
+	// Flush early when the buffer fills up faster than FlushInterval, e.g. at high server tick rates
+	TimeSinceFlush += DeltaTime;
+	if (TimeSinceFlush >= FlushInterval || Frames->Num() > RingCapacity / 2)
+		Flush();
+}
+
+void UBlasterTelemetrySubsystem::Flush()
+{
+	// The previous flush is still writing, the frames wait in the ring for the next one
+	if (FlushTask.IsValid() && !FlushTask.IsReady())
+		return;
+
+	TimeSinceFlush = 0.f;
+
+	TArray<FBlasterTelemetryConnection> Connections;
+	const UWorld* World = TrackedWorld.Get();
+	if (const UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr)
+	{
+		for (const UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			FBlasterTelemetryConnection& ConnectionInfo = Connections.AddDefaulted_GetRef();
+			const APlayerController* PlayerController = Connection->PlayerController;
+			ConnectionInfo.Name = PlayerController && PlayerController->PlayerState ? PlayerController->PlayerState->GetPlayerName() : Connection->LowLevelGetRemoteAddress();
+			ConnectionInfo.OutBytesPerSecond = Connection->OutBytesPerSecond;
+			ConnectionInfo.InBytesPerSecond = Connection->InBytesPerSecond;
+		}
+	}
+
+	const double SnapshotTime = World ? World->GetRealTimeSeconds() : 0.0;
+	FlushTask = Async(EAsyncExecution::ThreadPool, [this, Connections = MoveTemp(Connections), SnapshotTime]()
+	{
+		WriteFrames(Connections, SnapshotTime);
+	});
+}
+
+void UBlasterTelemetrySubsystem::WriteFrames(const TArray<FBlasterTelemetryConnection>& Connections, double SnapshotTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterTelemetryWrite);
+
+	// Files are only created once there is something to write, clients never record any frames
+	FString Csv;
+	if (bWriteCsv && !IFileManager::Get().FileExists(*CsvPath))
+	{
+		Csv = TEXT("frame,time,game_thread_ms,net_dispatch_ms,net_flush_ms,players,characters,weapons,connections,out_Bps,max_connection_out_Bps");
+		for (const TCHAR* RpcName : TelemetryRpcNames)
+			Csv += FString::Printf(TEXT(",rpc_%s"), RpcName);
+		Csv += LINE_TERMINATOR;
+	}
+	const int32 CsvHeaderLength = Csv.Len();
+
+	FString Json;
+
+	FBlasterTelemetryFrame Frame;
+	while (Frames->Pop(Frame))
+	{
+		if (bWriteCsv)
+		{
+			Csv += FString::Printf(TEXT("%llu,%.3f,%.3f,%.3f,%.3f,%u,%u,%u,%u,%u,%u"),
+				Frame.FrameNumber, Frame.Time, Frame.GameThreadMs, Frame.NetDispatchMs, Frame.NetFlushMs,
+				Frame.NumPlayers, Frame.NumCharacters, Frame.NumWeapons, Frame.NumConnections,
+				Frame.OutBytesPerSecond, Frame.MaxConnectionOutBytesPerSecond);
+			for (const uint16 Count : Frame.RpcCounts)
+				Csv += FString::Printf(TEXT(",%u"), Count);
+			Csv += LINE_TERMINATOR;
+		}
+
+		if (bWriteJson)
+		{
+			Json += FString::Printf(TEXT("{\"frame\":%llu,\"time\":%.3f,\"game_thread_ms\":%.3f,\"net_dispatch_ms\":%.3f,\"net_flush_ms\":%.3f,")
+				TEXT("\"players\":%u,\"characters\":%u,\"weapons\":%u,\"connections\":%u,\"out_Bps\":%u,\"max_connection_out_Bps\":%u,\"rpcs\":{"),
+				Frame.FrameNumber, Frame.Time, Frame.GameThreadMs, Frame.NetDispatchMs, Frame.NetFlushMs,
+				Frame.NumPlayers, Frame.NumCharacters, Frame.NumWeapons, Frame.NumConnections,
+				Frame.OutBytesPerSecond, Frame.MaxConnectionOutBytesPerSecond);
+			for (int32 RpcIndex = 0; RpcIndex < UE_ARRAY_COUNT(TelemetryRpcNames); ++RpcIndex)
+				Json += FString::Printf(TEXT("%s\"%s\":%u"), RpcIndex > 0 ? TEXT(",") : TEXT(""), TelemetryRpcNames[RpcIndex], Frame.RpcCounts[RpcIndex]);
+			Json += TEXT("}}") LINE_TERMINATOR;
+		}
+	}
+
+	if (Csv.Len() > CsvHeaderLength)
+		FFileHelper::SaveStringToFile(Csv, *CsvPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+
+	if (!Json.IsEmpty())
+		FFileHelper::SaveStringToFile(Json, *JsonPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+
+	if (bWriteCsv && Connections.Num() > 0)
+	{
+		FString ConnectionsCsv;
+		if (!IFileManager::Get().FileExists(*ConnectionsPath))
+			ConnectionsCsv = TEXT("time,connection,out_Bps,in_Bps") LINE_TERMINATOR;
+
+		// Player names are free text, quoted with embedded quotes doubled so commas and quotes in them survive
+		for (const FBlasterTelemetryConnection& Connection : Connections)
+			ConnectionsCsv += FString::Printf(TEXT("%.3f,\"%s\",%u,%u") LINE_TERMINATOR, SnapshotTime,
+				*Connection.Name.Replace(TEXT("\""), TEXT("\"\"")), Connection.OutBytesPerSecond, Connection.InBytesPerSecond);
+
+		FFileHelper::SaveStringToFile(ConnectionsCsv, *ConnectionsPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+	}
+}
@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include <atomic>
+#include "BlasterTelemetrySubsystem.generated.h"
+
+// Server RPCs counted per frame, see UCombatComponent::CountServerRpc
+enum class EBlasterTelemetryRpc : uint8
+{
+	CombatInput,
+	EquipWeapon,
+	Fire,
+	ScoreRequest,
+
+	MAX
+};
+
+struct FBlasterTelemetryFrame
+{
+	uint64 FrameNumber = 0;
+	double Time = 0.0;
+
+	// Game thread time of the previous frame, net dispatch and flush of this one
+	float GameThreadMs = 0.f;
+	float NetDispatchMs = 0.f;
+	float NetFlushMs = 0.f;
+
+	uint16 NumPlayers = 0;
+	uint16 NumCharacters = 0;
+	uint16 NumWeapons = 0;
+	uint16 NumConnections = 0;
+
+	uint32 OutBytesPerSecond = 0;
+	uint32 MaxConnectionOutBytesPerSecond = 0;
+
+	uint16 RpcCounts[static_cast<int32>(EBlasterTelemetryRpc::MAX)] = {};
+};
+
+struct FBlasterTelemetryConnection
+{
+	FString Name;
+	uint32 OutBytesPerSecond = 0;
+	uint32 InBytesPerSecond = 0;
+};
+
+/**
+ * Fixed size single producer, single consumer queue. The game thread pushes, the flush task pops,
+ * neither ever waits for the other; a full queue drops the new item.
+ */
+template<typename ItemType, uint32 Capacity>
+class TBlasterSpscRing
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	bool Push(const ItemType& Item)
+	{
+		const uint32 CurrentTail = Tail.load(std::memory_order_relaxed);
+		if (CurrentTail - Head.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		Items[CurrentTail & (Capacity - 1)] = Item;
+		Tail.store(CurrentTail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(ItemType& OutItem)
+	{
+		const uint32 CurrentHead = Head.load(std::memory_order_relaxed);
+		if (CurrentHead == Tail.load(std::memory_order_acquire))
+			return false;
+
+		OutItem = Items[CurrentHead & (Capacity - 1)];
+		Head.store(CurrentHead + 1, std::memory_order_release);
+		return true;
+	}
+
+	uint32 Num() const
+	{
+		return Tail.load(std::memory_order_acquire) - Head.load(std::memory_order_acquire);
+	}
+
+private:
+	std::atomic<uint32> Head{ 0 };
+	std::atomic<uint32> Tail{ 0 };
+	ItemType Items[Capacity];
+};
+
+/**
+ * Always-on server performance telemetry.
+ *
+ * Every frame on a server a small fixed size record (tick and net times, player, character and weapon
+ * counts, bandwidth and RPC counts) goes into a lock free ring buffer. Every FlushInterval a thread pool
+ * task drains it to Saved/Telemetry as CSV and/or JSON lines, together with a bandwidth snapshot per
+ * connection. The game thread cost is a handful of counters per frame, see "Telemetry Sample".
+ */
+UCLASS(Config = Game)
+class BLASTER_API UBlasterTelemetrySubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+
+	// Server side, called when an RPC from a client is executed
+	FORCEINLINE void CountRpc(EBlasterTelemetryRpc Rpc) { ++PendingRpcCounts[static_cast<int32>(Rpc)]; }
+
+	// The newest frame recorded, all zero until the server has ticked with telemetry enabled
+	FORCEINLINE const FBlasterTelemetryFrame& GetLastFrame() const { return LastFrame; }
+
+private:
+	void TrackWorld(UWorld* World);
+	void OnWorldTickStart(UWorld* World, ELevelTick TickType, float DeltaTime);
+	void OnWorldPreActorTick(UWorld* World, ELevelTick TickType, float DeltaTime);
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaTime);
+	void OnPostTickFlush();
+
+	void Flush();
+	void WriteFrames(const TArray<FBlasterTelemetryConnection>& Connections, double SnapshotTime);
+
+	UPROPERTY(Config)
+	bool bEnabled = true;
+
+	UPROPERTY(Config)
+	float FlushInterval = 5.f;
+
+	UPROPERTY(Config)
+	bool bWriteCsv = true;
+
+	UPROPERTY(Config)
+	bool bWriteJson = false;
+
+	static constexpr uint32 RingCapacity = 4096;
+	TUniquePtr<TBlasterSpscRing<FBlasterTelemetryFrame, RingCapacity>> Frames;
+
+	TFuture<void> FlushTask;
+	float TimeSinceFlush = 0.f;
+
+	FString CsvPath;
+	FString JsonPath;
+	FString ConnectionsPath;
+
+	TWeakObjectPtr<UWorld> TrackedWorld;
+	FDelegateHandle PostTickFlushHandle;
+
+	uint64 TickStartCycles = 0;
+	uint64 PostActorTickCycles = 0;
+	uint64 NetDispatchCycles = 0;
+	uint64 NetFlushCycles = 0;
+
+	uint16 PendingRpcCounts[static_cast<int32>(EBlasterTelemetryRpc::MAX)] = {};
+
+	FBlasterTelemetryFrame LastFrame;
+};
@@ -0,0 +1,288 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterTickSubsystem.h"
+#include "Blaster/Blaster.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/BlasterComponents/CombatComponent.h"
+#include "Blaster/Weapon/Weapon.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/PlayerController.h"
+
+DECLARE_CYCLE_STAT(TEXT("Tick Manager"), STAT_BlasterTickManager, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Aim Offsets Updated"), STAT_BlasterAimOffsetsUpdated, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Aim Offsets Throttled"), STAT_BlasterAimOffsetsThrottled, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Managed Characters"), STAT_BlasterManagedCharacters, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Managed Weapons"), STAT_BlasterManagedWeapons, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Weapons With Mesh Tick"), STAT_BlasterTickingWeapons, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim LOD Tier 0"), STAT_BlasterAnimLODTier0, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim LOD Tier 1"), STAT_BlasterAnimLODTier1, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim LOD Tier 2"), STAT_BlasterAnimLODTier2, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Anim LOD Tier 3+"), STAT_BlasterAnimLODTier3, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Poses Full Rate"), STAT_BlasterServerPosesFullRate, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Server Poses Throttled"), STAT_BlasterServerPosesThrottled, STATGROUP_Blaster);
+
+void UBlasterTickSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterTickManager);
+
+	ViewLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController && PlayerController->IsLocalController())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+
+	AnimLODTierCounts.Reset();
+	AnimLODTierCounts.SetNumZeroed(AnimLODTiers.Num());
+
+	const bool bServerPoses = bThrottleServerPoses && GetWorld()->GetNetMode() == NM_DedicatedServer;
+	const double Now = GetWorld()->GetTimeSeconds();
+
+	for (int32 Index = 0; Index < Characters.Num(); ++Index)
+	{
+		ABlasterCharacter* Character = Characters[Index];
+		float CharacterDeltaTime = DeltaTime;
+
+		const bool bLocallyControlled = Character->IsLocallyControlled();
+		const bool bRecentlyRendered = bLocallyControlled || Character->WasRecentlyRendered(0.2f);
+		const float DistanceSquared = bLocallyControlled ? 0.f : GetMinViewDistanceSquared(Character);
+
+		// Only a player has a crosshair to trace from
+		if (bLocallyControlled && Character->Combat && Character->IsPlayerControlled())
+			Character->Combat->UpdateCrosshairTrace();
+
+		// Nobody looks at characters on a dedicated server, their pose rate follows the shots there instead
+		if (bServerPoses)
+			UpdateServerPose(Index, Now);
+
+		if (ViewLocations.Num() > 0 && AnimLODTiers.Num() > 0)
+		{
+			const int32 TierIndex = bLocallyControlled ? 0 : SelectAnimLODTier(DistanceSquared, bRecentlyRendered);
+			if (AppliedAnimLODTiers[Index] != TierIndex && ApplyAnimLODTier(Character, TierIndex))
+				AppliedAnimLODTiers[Index] = TierIndex;
+
+			++AnimLODTierCounts[TierIndex];
+		}
+
+		if (Character->GetLocalRole() == ROLE_SimulatedProxy)
+		{
+			AccumulatedTimes[Index] += DeltaTime;
+			if (AccumulatedTimes[Index] < GetSimulatedUpdateInterval(DistanceSquared, bRecentlyRendered))
+			{
+				INC_DWORD_STAT(STAT_BlasterAimOffsetsThrottled);
+				continue;
+			}
+
+			CharacterDeltaTime = AccumulatedTimes[Index];
+			AccumulatedTimes[Index] = 0.f;
+		}
+
+		Character->AimOffset(CharacterDeltaTime);
+		INC_DWORD_STAT(STAT_BlasterAimOffsetsUpdated);
+	}
+
+	for (int32 TierIndex = 0; TierIndex < AnimLODTierCounts.Num(); ++TierIndex)
+	{
+		const int32 Count = AnimLODTierCounts[TierIndex];
+		switch (TierIndex)
+		{
+		case 0:
+			INC_DWORD_STAT_BY(STAT_BlasterAnimLODTier0, Count);
+			break;
+		case 1:
+			INC_DWORD_STAT_BY(STAT_BlasterAnimLODTier1, Count);
+			break;
+		case 2:
+			INC_DWORD_STAT_BY(STAT_BlasterAnimLODTier2, Count);
+			break;
+		default:
+			INC_DWORD_STAT_BY(STAT_BlasterAnimLODTier3, Count);
+			break;
+		}
+	}
+}
+
+TStatId UBlasterTickSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UBlasterTickSubsystem, STATGROUP_Tickables);
+}
+
+bool UBlasterTickSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+float UBlasterTickSubsystem::GetMinViewDistanceSquared(const ABlasterCharacter* Character) const
+{
+	const FVector Location = Character->GetActorLocation();
+	float MinDistanceSquared = TNumericLimits<float>::Max();
+	for (const FVector& ViewLocation : ViewLocations)
+		MinDistanceSquared = FMath::Min(MinDistanceSquared, static_cast<float>(FVector::DistSquared(Location, ViewLocation)));
+
+	return MinDistanceSquared;
+}
+
+float UBlasterTickSubsystem::GetSimulatedUpdateInterval(float DistanceSquared, bool bRecentlyRendered) const
+{
+	if (!bRecentlyRendered)
+		return NotRenderedUpdateInterval;
+
+	if (DistanceSquared <= FMath::Square(NearDistance))
+		return 0.f;
+
+	return DistanceSquared <= FMath::Square(FarDistance) ? MidUpdateInterval : FarUpdateInterval;
+}
+
+int32 UBlasterTickSubsystem::SelectAnimLODTier(float DistanceSquared, bool bRecentlyRendered) const
+{
+	const int32 LastTier = AnimLODTiers.Num() - 1;
+	if (!bRecentlyRendered)
+		return LastTier;
+
+	for (int32 TierIndex = 0; TierIndex < LastTier; ++TierIndex)
+	{
+		const float MaxDistance = AnimLODTiers[TierIndex].MaxDistance;
+		if (MaxDistance <= 0.f || DistanceSquared <= FMath::Square(MaxDistance))
+			return TierIndex;
+	}
+
+	return LastTier;
+}
+
+bool UBlasterTickSubsystem::ApplyAnimLODTier(ABlasterCharacter* Character, int32 TierIndex) const
+{
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	UBlasterAnimInstance* AnimInstance = Mesh ? Cast<UBlasterAnimInstance>(Mesh->GetAnimInstance()) : nullptr;
+	if (!AnimInstance)
+		return false;
+
+	const FBlasterAnimLODTier& Tier = AnimLODTiers[TierIndex];
+	AnimInstance->SetAnimLODTier(Tier);
+
+	// Pin every mesh LOD to the tier's frame skip so the evaluation rate follows our tiers rather than screen size
+	FAnimUpdateRateParameters* UpdateRateParams = Mesh->AnimUpdateRateParams;
+	if (UpdateRateParams)
+	{
+		UpdateRateParams->bShouldUseLodMap = true;
+		UpdateRateParams->LODToFrameSkipMap.Reset();
+		for (int32 LODIndex = 0; LODIndex < MAX_SKELETAL_MESH_LODS; ++LODIndex)
+			UpdateRateParams->LODToFrameSkipMap.Add(LODIndex, Tier.FrameSkip);
+
+		UpdateRateParams->MaxEvalRateForInterpolation = Tier.bInterpolateSkippedFrames ? Tier.FrameSkip + 2 : 0;
+	}
+
+	return true;
+}
+
+void UBlasterTickSubsystem::UpdateServerPose(int32 Index, double Now)
+{
+	const bool bFullRate = Now < FullRatePoseUntil[Index];
+	if (bFullRate)
+		INC_DWORD_STAT(STAT_BlasterServerPosesFullRate);
+	else
+		INC_DWORD_STAT(STAT_BlasterServerPosesThrottled);
+
+	const float Interval = bFullRate ? 0.f : ServerPoseInterval;
+	if (AppliedPoseIntervals[Index] == Interval)
+		return;
+
+	// Between two evaluations the mesh keeps its last pose and still follows the capsule, which is what lag compensation records
+	USkeletalMeshComponent* Mesh = Characters[Index]->GetMesh();
+	if (!Mesh)
+		return;
+
+	Mesh->SetComponentTickInterval(Interval);
+	AppliedPoseIntervals[Index] = Interval;
+}
+
+void UBlasterTickSubsystem::NotifyShot(const FVector& Start, const FVector& End)
+{
+	if (!bThrottleServerPoses || GetWorld()->GetNetMode() != NM_DedicatedServer)
+		return;
+
+	const double Until = GetWorld()->GetTimeSeconds() + ShotAlertDuration;
+	const float RadiusSquared = FMath::Square(ShotAlertRadius);
+	for (int32 Index = 0; Index < Characters.Num(); ++Index)
+	{
+		if (FMath::PointDistToSegmentSquared(Characters[Index]->GetActorLocation(), Start, End) <= RadiusSquared)
+			FullRatePoseUntil[Index] = Until;
+	}
+}
+
+void UBlasterTickSubsystem::RegisterCharacter(ABlasterCharacter* Character)
+{
+	if (!Character || Characters.Contains(Character))
+		return;
+
+	Characters.Add(Character);
+	AccumulatedTimes.Add(0.f);
+	AppliedAnimLODTiers.Add(INDEX_NONE);
+	FullRatePoseUntil.Add(0.0);
+	AppliedPoseIntervals.Add(0.f);
+	SET_DWORD_STAT(STAT_BlasterManagedCharacters, Characters.Num());
+}
+
+void UBlasterTickSubsystem::UnregisterCharacter(ABlasterCharacter* Character)
+{
+	const int32 Index = Characters.Find(Character);
+	if (Index == INDEX_NONE)
+		return;
+
+	Characters.RemoveAtSwap(Index);
+	AccumulatedTimes.RemoveAtSwap(Index);
+	AppliedAnimLODTiers.RemoveAtSwap(Index);
+	FullRatePoseUntil.RemoveAtSwap(Index);
+	AppliedPoseIntervals.RemoveAtSwap(Index);
+	SET_DWORD_STAT(STAT_BlasterManagedCharacters, Characters.Num());
+}
+
+void UBlasterTickSubsystem::RegisterWeapon(AWeapon* Weapon)
+{
+	if (!Weapon || Weapons.Contains(Weapon))
+		return;
+
+	Weapons.Add(Weapon);
+	SET_DWORD_STAT(STAT_BlasterManagedWeapons, Weapons.Num());
+
+	if (Weapon->GetWeaponMesh() && Weapon->GetWeaponMesh()->IsComponentTickEnabled())
+		INC_DWORD_STAT(STAT_BlasterTickingWeapons);
+
+	OnWeaponStateChanged(Weapon);
+}
+
+void UBlasterTickSubsystem::UnregisterWeapon(AWeapon* Weapon)
+{
+	if (Weapons.RemoveSwap(Weapon) == 0)
+		return;
+
+	SET_DWORD_STAT(STAT_BlasterManagedWeapons, Weapons.Num());
+
+	if (Weapon->GetWeaponMesh() && Weapon->GetWeaponMesh()->IsComponentTickEnabled())
+		DEC_DWORD_STAT(STAT_BlasterTickingWeapons);
+}
+
+void UBlasterTickSubsystem::OnWeaponStateChanged(AWeapon* Weapon)
+{
+	USkeletalMeshComponent* WeaponMesh = Weapon ? Weapon->GetWeaponMesh() : nullptr;
+	if (!WeaponMesh)
+		return;
+
+	// A weapon lying around has nothing to animate, only an equipped one plays fire animations
+	const bool bShouldTick = Weapon->GetWeaponState() == EWeaponState::EWS_Equipped;
+	if (WeaponMesh->IsComponentTickEnabled() == bShouldTick)
+		return;
+
+	WeaponMesh->SetComponentTickEnabled(bShouldTick);
+
+	if (bShouldTick)
+		INC_DWORD_STAT(STAT_BlasterTickingWeapons);
+	else
+		DEC_DWORD_STAT(STAT_BlasterTickingWeapons);
+}
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Blaster/Character/BlasterAnimInstance.h"
+#include "BlasterTickSubsystem.generated.h"
+
+class ABlasterCharacter;
+class AWeapon;
+
+/**
+ * Replaces the per-actor Tick of characters and weapons with a single pass over contiguous arrays.
+ *
+ * Characters run their aim offset from here, simulated proxies at a rate chosen from their distance
+ * to the local view and whether they were rendered recently. The same significance picks the
+ * animation LOD tier of every character that is not locally controlled. Weapons never tick as
+ * actors and only keep their mesh ticking while equipped.
+ *
+ * On a dedicated server poses only matter to lag compensation, so character meshes evaluate at
+ * ServerPoseInterval and go back to full rate for a while when a shot passes near them.
+ */
+UCLASS(Config = Game)
+class BLASTER_API UBlasterTickSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterCharacter(ABlasterCharacter* Character);
+	void UnregisterCharacter(ABlasterCharacter* Character);
+
+	void RegisterWeapon(AWeapon* Weapon);
+	void UnregisterWeapon(AWeapon* Weapon);
+	void OnWeaponStateChanged(AWeapon* Weapon);
+
+	// Server side, puts the poses of characters near the shot's line back to full rate for ShotAlertDuration
+	void NotifyShot(const FVector& Start, const FVector& End);
+
+	FORCEINLINE int32 GetNumCharacters() const { return Characters.Num(); }
+	FORCEINLINE const TArray<ABlasterCharacter*>& GetCharacters() const { return Characters; }
+	FORCEINLINE int32 GetNumWeapons() const { return Weapons.Num(); }
+	FORCEINLINE const TArray<int32>& GetAnimLODTierCounts() const { return AnimLODTierCounts; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	float GetMinViewDistanceSquared(const ABlasterCharacter* Character) const;
+	float GetSimulatedUpdateInterval(float DistanceSquared, bool bRecentlyRendered) const;
+	int32 SelectAnimLODTier(float DistanceSquared, bool bRecentlyRendered) const;
+	bool ApplyAnimLODTier(ABlasterCharacter* Character, int32 TierIndex) const;
+	void UpdateServerPose(int32 Index, double Now);
+
+	//
+	// Significance settings for simulated proxies, set in DefaultGame.ini
+	//
+
+	UPROPERTY(Config)
+	float NearDistance = 2000.f;
+
+	UPROPERTY(Config)
+	float FarDistance = 6000.f;
+
+	UPROPERTY(Config)
+	float MidUpdateInterval = 1.f / 30.f;
+
+	UPROPERTY(Config)
+	float FarUpdateInterval = 1.f / 10.f;
+
+	UPROPERTY(Config)
+	float NotRenderedUpdateInterval = 1.f / 4.f;
+
+	// Ordered near to far, characters that were not rendered recently use the last tier
+	UPROPERTY(Config)
+	TArray<FBlasterAnimLODTier> AnimLODTiers;
+
+	//
+	// Dedicated server pose rate, set in DefaultGame.ini
+	//
+
+	UPROPERTY(Config)
+	bool bThrottleServerPoses = true;
+
+	// Mesh tick interval of characters no shot went near lately
+	UPROPERTY(Config)
+	float ServerPoseInterval = 0.1f;
+
+	// Characters this close to the line of a shot are woken up
+	UPROPERTY(Config)
+	float ShotAlertRadius = 2500.f;
+
+	// Should cover the lag compensation window, so follow up shots rewind through full rate frames
+	UPROPERTY(Config)
+	float ShotAlertDuration = 1.f;
+
+	UPROPERTY()
+	TArray<ABlasterCharacter*> Characters;
+
+	// Parallel to Characters, time since the last aim offset update
+	TArray<float> AccumulatedTimes;
+
+	// Parallel to Characters, anim LOD tier currently applied or INDEX_NONE
+	TArray<int32> AppliedAnimLODTiers;
+
+	// Parallel to Characters, world time until which the server evaluates the pose every frame
+	TArray<double> FullRatePoseUntil;
+
+	// Parallel to Characters, mesh tick interval currently applied on the server
+	TArray<float> AppliedPoseIntervals;
+
+	// Characters per anim LOD tier during the last tick
+	TArray<int32> AnimLODTierCounts;
+
+	UPROPERTY()
+	TArray<AWeapon*> Weapons;
+
+	// View locations of the local players, refreshed every tick
+	TArray<FVector> ViewLocations;
+};
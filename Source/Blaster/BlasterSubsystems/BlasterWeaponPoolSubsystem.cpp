@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterWeaponPoolSubsystem.h"
+#include "Blaster/Blaster.h"
+#include "Blaster/Weapon/Weapon.h"
+
+DECLARE_CYCLE_STAT(TEXT("Weapon Pool Acquire"), STAT_BlasterWeaponPoolAcquire, STATGROUP_Blaster);
+DECLARE_CYCLE_STAT(TEXT("Weapon Pool Spawn"), STAT_BlasterWeaponPoolSpawn, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Weapon Pool Hits"), STAT_BlasterWeaponPoolHits, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Weapon Pool Misses"), STAT_BlasterWeaponPoolMisses, STATGROUP_Blaster);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Weapon Pool Free"), STAT_BlasterWeaponPoolFree, STATGROUP_Blaster);
+
+bool UBlasterWeaponPoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UBlasterWeaponPoolSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	if (InWorld.GetNetMode() == NM_Client)
+		return;
+
+	for (const FBlasterWeaponPoolClass& PoolClass : PooledWeaponClasses)
+	{
+		UClass* WeaponClass = PoolClass.WeaponClass.LoadSynchronous();
+		if (!WeaponClass)
+			continue;
+
+		FBlasterWeaponPoolList& FreeList = FreeWeapons.FindOrAdd(WeaponClass);
+		for (int32 Count = 0; Count < PoolClass.PrewarmCount; ++Count)
+		{
+			AWeapon* Weapon = SpawnPooledWeapon(WeaponClass, FTransform::Identity);
+			if (!Weapon)
+				break;
+
+			FreeList.Weapons.Add(Weapon);
+			INC_DWORD_STAT(STAT_BlasterWeaponPoolFree);
+		}
+	}
+}
+
+void UBlasterWeaponPoolSubsystem::Deinitialize()
+{
+	if (NumHits + NumMisses > 0)
+		UE_LOG(LogBlaster, Log, TEXT("Weapon pool: %d hits, %d misses (%.1f%% hit rate)"), NumHits, NumMisses, 100.f * NumHits / (NumHits + NumMisses));
+
+	for (const TPair<UClass*, FBlasterWeaponPoolList>& Pair : FreeWeapons)
+		DEC_DWORD_STAT_BY(STAT_BlasterWeaponPoolFree, Pair.Value.Weapons.Num());
+
+	FreeWeapons.Reset();
+
+	Super::Deinitialize();
+}
+
+AWeapon* UBlasterWeaponPoolSubsystem::SpawnPooledWeapon(UClass* WeaponClass, const FTransform& Transform)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterWeaponPoolSpawn);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AWeapon* Weapon = GetWorld()->SpawnActor<AWeapon>(WeaponClass, Transform, SpawnParams);
+	if (Weapon)
+		Weapon->EnterPool();
+
+	return Weapon;
+}
+
+AWeapon* UBlasterWeaponPoolSubsystem::AcquireWeapon(TSubclassOf<AWeapon> WeaponClass, const FTransform& Transform, AActor* Requester)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BlasterWeaponPoolAcquire);
+
+	if (!WeaponClass || GetWorld()->GetNetMode() == NM_Client)
+		return nullptr;
+
+	AWeapon* Weapon = nullptr;
+
+	FBlasterWeaponPoolList* FreeList = FreeWeapons.Find(WeaponClass);
+	while (FreeList && !Weapon && FreeList->Weapons.Num() > 0)
+	{
+		// Pooled weapons can still be destroyed from the outside, e.g. by a level unload
+		AWeapon* Candidate = FreeList->Weapons.Pop(false);
+		DEC_DWORD_STAT(STAT_BlasterWeaponPoolFree);
+		if (IsValid(Candidate))
+			Weapon = Candidate;
+	}
+
+	if (Weapon)
+	{
+		++NumHits;
+		INC_DWORD_STAT(STAT_BlasterWeaponPoolHits);
+	}
+	else
+	{
+		++NumMisses;
+		INC_DWORD_STAT(STAT_BlasterWeaponPoolMisses);
+		Weapon = SpawnPooledWeapon(WeaponClass, Transform);
+		if (!Weapon)
+			return nullptr;
+	}
+
+	Weapon->LeavePool(Transform, Requester);
+	return Weapon;
+}
+
+void UBlasterWeaponPoolSubsystem::ReleaseWeapon(AWeapon* Weapon)
+{
+	if (!IsValid(Weapon) || !Weapon->HasAuthority())
+		return;
+
+	// The holder has to let go of the weapon first, the pool knows nothing about combat components
+	if (Weapon->GetWeaponState() == EWeaponState::EWS_Equipped)
+		return;
+
+	FBlasterWeaponPoolList& FreeList = FreeWeapons.FindOrAdd(Weapon->GetClass());
+	if (FreeList.Weapons.Contains(Weapon))
+		return;
+
+	Weapon->EnterPool();
+	FreeList.Weapons.Add(Weapon);
+	INC_DWORD_STAT(STAT_BlasterWeaponPoolFree);
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BlasterWeaponPoolSubsystem.generated.h"
+
+class AWeapon;
+
+USTRUCT()
+struct FBlasterWeaponPoolClass
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	TSoftClassPtr<AWeapon> WeaponClass;
+
+	// Instances spawned when the world begins play, before anyone asks for one
+	UPROPERTY(Config)
+	int32 PrewarmCount = 0;
+};
+
+USTRUCT()
+struct FBlasterWeaponPoolList
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<AWeapon*> Weapons;
+};
+
+/**
+ * Server side pool of weapon actors, so weapons are recycled instead of spawned and destroyed during a match.
+ *
+ * Pooled weapons stay in the world hidden, without collision and net dormant. Acquiring one moves it,
+ * resets its state and wakes it up; an empty pool falls back to spawning and counts as a miss.
+ * Weapons come back when a spawn point goes away untouched or when a dropped weapon has been lying
+ * around for AWeapon::DroppedLifetime, e.g. after its holder died.
+ */
+UCLASS(Config = Game)
+class BLASTER_API UBlasterWeaponPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	// Requester becomes the weapon's AWeapon::GetPoolOwner until the weapon is released again
+	AWeapon* AcquireWeapon(TSubclassOf<AWeapon> WeaponClass, const FTransform& Transform, AActor* Requester = nullptr);
+	void ReleaseWeapon(AWeapon* Weapon);
+
+	FORCEINLINE int32 GetNumHits() const { return NumHits; }
+	FORCEINLINE int32 GetNumMisses() const { return NumMisses; }
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	AWeapon* SpawnPooledWeapon(UClass* WeaponClass, const FTransform& Transform);
+
+	UPROPERTY(Config)
+	TArray<FBlasterWeaponPoolClass> PooledWeaponClasses;
+
+	UPROPERTY()
+	TMap<UClass*, FBlasterWeaponPoolList> FreeWeapons;
+
+	int32 NumHits = 0;
+	int32 NumMisses = 0;
+};
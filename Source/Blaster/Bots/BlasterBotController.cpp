@@ -0,0 +1,16 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterBotController.h"
+#include "Blaster/BlasterComponents/BlasterBotComponent.h"
+
+ABlasterBotController::ABlasterBotController()
+{
+	// Shows up in the player list and gets a player state like a connected player would
+	bWantsPlayerState = true;
+
+	// The bot component owns the control rotation, don't snap it back to the pawn every frame
+	bSetControlRotationFromPawnOrientation = false;
+
+	BotComponent = CreateDefaultSubobject<UBlasterBotComponent>(TEXT("Bot"));
+}
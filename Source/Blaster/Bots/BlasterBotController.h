@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "BlasterBotController.generated.h"
+
+/**
+ * Server side bot, spawned by UBlasterBotSubsystem. All the playing is done by its UBlasterBotComponent.
+ */
+UCLASS()
+class BLASTER_API ABlasterBotController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	ABlasterBotController();
+
+private:
+	UPROPERTY(VisibleAnywhere)
+	class UBlasterBotComponent* BotComponent;
+};
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterAimState.h"
+
+void FBlasterAimState::SetAimRotation(const FRotator& AimRotation)
+{
+	Yaw = FRotator::CompressAxisToShort(AimRotation.Yaw);
+	Pitch = FRotator::CompressAxisToShort(AimRotation.Pitch);
+}
+
+FRotator FBlasterAimState::GetAimRotation() const
+{
+	return FRotator(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), 0.f).GetNormalized();
+}
+
+bool FBlasterAimState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Ar << Yaw;
+	Ar << Pitch;
+
+	uint8 Flags = (bAiming ? 1 : 0) | (bCrouched ? 2 : 0);
+	Ar.SerializeBits(&Flags, 2);
+
+	if (Ar.IsLoading())
+	{
+		bAiming = (Flags & 1) != 0;
+		bCrouched = (Flags & 2) != 0;
+	}
+
+	bOutSuccess = true;
+	return true;
+}
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BlasterAimState.generated.h"
+
+/**
+ * What simulated proxies need to pose a character's upper body, packed into 34 bits on the wire:
+ * aim yaw and pitch quantized to 16 bits each, then the aiming and crouched flags.
+ */
+USTRUCT()
+struct FBlasterAimState
+{
+	GENERATED_BODY()
+
+	FBlasterAimState()
+		: bAiming(false)
+		, bCrouched(false)
+	{
+	}
+
+	void SetAimRotation(const FRotator& AimRotation);
+	FRotator GetAimRotation() const;
+
+	FORCEINLINE void SetAiming(bool bInAiming) { bAiming = bInAiming; }
+	FORCEINLINE bool IsAiming() const { return bAiming; }
+	FORCEINLINE void SetCrouched(bool bInCrouched) { bCrouched = bInCrouched; }
+	FORCEINLINE bool IsCrouched() const { return bCrouched; }
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FBlasterAimState& Other) const
+	{
+		return Yaw == Other.Yaw && Pitch == Other.Pitch && bAiming == Other.bAiming && bCrouched == Other.bCrouched;
+	}
+
+	bool operator!=(const FBlasterAimState& Other) const { return !(*this == Other); }
+
+private:
+	UPROPERTY()
+	uint16 Yaw = 0;
+
+	UPROPERTY()
+	uint16 Pitch = 0;
+
+	UPROPERTY()
+	uint8 bAiming : 1;
+
+	UPROPERTY()
+	uint8 bCrouched : 1;
+};
+
+template<>
+struct TStructOpsTypeTraits<FBlasterAimState> : public TStructOpsTypeTraitsBase2<FBlasterAimState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
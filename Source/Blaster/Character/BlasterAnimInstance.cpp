@@ -5,7 +5,45 @@
 #include "BlasterCharacter.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "Blaster/Blaster.h"
 #include "Blaster/Weapon/Weapon.h"
+#include <atomic>
+
+DECLARE_CYCLE_STAT(TEXT("Anim Gather"), STAT_BlasterAnimGather, STATGROUP_Blaster);
+DECLARE_CYCLE_STAT(TEXT("Anim Thread Safe Update"), STAT_BlasterAnimThreadSafeUpdate, STATGROUP_Blaster);
+
+static const FName LeftHandSocketName(TEXT("LeftHandSocket"));
+static const FName RightHandBoneName(TEXT("hand_r"));
+
+// Totals behind UBlasterAnimInstance::ConsumeUpdateCycles, thread safe updates add to them from the workers
+static std::atomic<uint64> GatherCycles{ 0 };
+static std::atomic<uint64> ThreadSafeUpdateCycles{ 0 };
+static std::atomic<int32> NumGathers{ 0 };
+static std::atomic<int32> NumThreadSafeUpdates{ 0 };
+static std::atomic<int32> NumWorkerUpdates{ 0 };
+
+// Adds the time until the end of the scope to Cycles, does nothing in shipping builds
+struct FAnimUpdateCycleScope
+{
+  FAnimUpdateCycleScope(std::atomic<uint64>& InCycles, std::atomic<int32>& Count)
+    : Cycles(InCycles)
+  {
+#if !UE_BUILD_SHIPPING
+    ++Count;
+    StartCycles = FPlatformTime::Cycles64();
+#endif
+  }
+
+  ~FAnimUpdateCycleScope()
+  {
+#if !UE_BUILD_SHIPPING
+    Cycles += FPlatformTime::Cycles64() - StartCycles;
+#endif
+  }
+
+  std::atomic<uint64>& Cycles;
+  uint64 StartCycles = 0;
+};
 
 void UBlasterAnimInstance::NativeInitializeAnimation()
 {
@@ -18,55 +56,117 @@ void UBlasterAnimInstance::NativeUpdateAnimation(float DeltaTime)
 {
   Super::NativeUpdateAnimation(DeltaTime);
 
+  SCOPE_CYCLE_COUNTER(STAT_BlasterAnimGather);
+  FAnimUpdateCycleScope CycleScope(GatherCycles, NumGathers);
+
   if (BlasterCharacter == nullptr)
     BlasterCharacter = Cast<ABlasterCharacter>(TryGetPawnOwner());
 
   if (BlasterCharacter == nullptr) return;
 
-  FVector Velocity = BlasterCharacter->GetVelocity();
-  Velocity.Z = 0.f;
-  Speed = Velocity.Size();
-
-  bIsInAir = BlasterCharacter->GetCharacterMovement()->IsFalling();
+  // Game thread side: only copy what the update needs, the math runs in NativeThreadSafeUpdateAnimation
+  const UCharacterMovementComponent* MovementComponent = BlasterCharacter->GetCharacterMovement();
 
-  bIsAccelerating = BlasterCharacter->GetCharacterMovement()->GetCurrentAcceleration().Size() > 0.f ? true : false;
+  GatherData.Velocity = BlasterCharacter->GetVelocity();
+  GatherData.Acceleration = MovementComponent->GetCurrentAcceleration();
+  GatherData.bIsInAir = MovementComponent->IsFalling();
+  GatherData.bWeaponEquipped = BlasterCharacter->IsWeaponEquipped();
+  GatherData.bIsCrouched = BlasterCharacter->bIsCrouched;
+  GatherData.bIsAiming = BlasterCharacter->IsAiming();
+  GatherData.AimRotation = BlasterCharacter->GetBaseAimRotation();
+  GatherData.ActorRotation = BlasterCharacter->GetActorRotation();
+  GatherData.AO_Yaw = BlasterCharacter->GetAO_Yaw();
+  GatherData.AO_Pitch = BlasterCharacter->GetAO_Pitch();
 
-  bWeaponEquipped = BlasterCharacter->IsWeaponEquipped();
-  bIsCrouched = BlasterCharacter->bIsCrouched;
-  bIsAiming = BlasterCharacter->IsAiming();
   EquippedWeapon = BlasterCharacter->GetEquippedWeapon();
 
+  GatherData.bUpdateLean = AnimLODTier.bUpdateLean;
+  GatherData.bInterpolateYawOffset = AnimLODTier.bInterpolateYawOffset;
+
+  // BlasterAnim_BP runs FABRIK off LeftHandTransform without reading bUseHandIK, a stale transform detaches the hand,
+  // so the target is kept up to date on every tier until the graph blends the IK out itself
+  bUseHandIK = AnimLODTier.bUpdateHandIK;
+  GatherData.bHasLeftHandTarget = GatherData.bWeaponEquipped && EquippedWeapon && EquippedWeapon->GetWeaponMesh() && BlasterCharacter->GetMesh();
+  if (GatherData.bHasLeftHandTarget)
+  {
+    GatherData.LeftHandSocketTransform = EquippedWeapon->GetWeaponMesh()->GetSocketTransform(LeftHandSocketName, ERelativeTransformSpace::RTS_World);
+    GatherData.RightHandBoneTransform = BlasterCharacter->GetMesh()->GetSocketTransform(RightHandBoneName, ERelativeTransformSpace::RTS_World);
+  }
+}
+
+void UBlasterAnimInstance::NativeThreadSafeUpdateAnimation(float DeltaTime)
+{
+  Super::NativeThreadSafeUpdateAnimation(DeltaTime);
+
+  SCOPE_CYCLE_COUNTER(STAT_BlasterAnimThreadSafeUpdate);
+  FAnimUpdateCycleScope CycleScope(ThreadSafeUpdateCycles, NumThreadSafeUpdates);
+#if !UE_BUILD_SHIPPING
+  if (!IsInGameThread())
+    ++NumWorkerUpdates;
+#endif
+
+  if (BlasterCharacter == nullptr || DeltaTime <= 0.f) return;
+
+  FVector Velocity = GatherData.Velocity;
+  Velocity.Z = 0.f;
+  Speed = Velocity.Size();
+
+  bIsInAir = GatherData.bIsInAir;
+  bIsAccelerating = GatherData.Acceleration.Size() > 0.f ? true : false;
+  bWeaponEquipped = GatherData.bWeaponEquipped;
+  bIsCrouched = GatherData.bIsCrouched;
+  bIsAiming = GatherData.bIsAiming;
 
-  FRotator AimRotation = BlasterCharacter->GetBaseAimRotation();
-  FRotator MovementRotation = UKismetMathLibrary::MakeRotFromX(BlasterCharacter->GetVelocity());
+  FRotator AimRotation = GatherData.AimRotation;
+  FRotator MovementRotation = UKismetMathLibrary::MakeRotFromX(GatherData.Velocity);
 
   //Smooth transition to opposite animation / value
   FRotator DeltaRot = UKismetMathLibrary::NormalizedDeltaRotator(MovementRotation, AimRotation);
-  DeltaRotation = FMath::RInterpTo(DeltaRotation, DeltaRot, DeltaTime, 5.f);
+  DeltaRotation = GatherData.bInterpolateYawOffset ? FMath::RInterpTo(DeltaRotation, DeltaRot, DeltaTime, 5.f) : DeltaRot;
 
   YawOffset = DeltaRotation.Yaw;
 
   CharacterRotationLastFrame = CharacterRotation;
-  CharacterRotation = BlasterCharacter->GetActorRotation();
+  CharacterRotation = GatherData.ActorRotation;
 
-  const FRotator Delta = UKismetMathLibrary::NormalizedDeltaRotator(CharacterRotation, CharacterRotationLastFrame);
-  const float Target = Delta.Yaw / DeltaTime;
-  const float Interp = FMath::FInterpTo(Lean, Target, DeltaTime, 6.f);
-  Lean = FMath::Clamp(Interp, -90.f, 90.f);
+  if (GatherData.bUpdateLean)
+  {
+    const FRotator Delta = UKismetMathLibrary::NormalizedDeltaRotator(CharacterRotation, CharacterRotationLastFrame);
+    const float Target = Delta.Yaw / DeltaTime;
+    const float Interp = FMath::FInterpTo(Lean, Target, DeltaTime, 6.f);
+    Lean = FMath::Clamp(Interp, -90.f, 90.f);
+  }
+  else
+  {
+    Lean = 0.f;
+  }
 
-  AO_Yaw = BlasterCharacter->GetAO_Yaw();
-  AO_Pitch = BlasterCharacter->GetAO_Pitch();
+  AO_Yaw = GatherData.AO_Yaw;
+  AO_Pitch = GatherData.AO_Pitch;
 
-  if (bWeaponEquipped && EquippedWeapon && EquippedWeapon->GetWeaponMesh() && BlasterCharacter->GetMesh())
+  if (GatherData.bHasLeftHandTarget)
   {
-    LeftHandTransform = EquippedWeapon->GetWeaponMesh()->GetSocketTransform(FName("LeftHandSocket"), ERelativeTransformSpace::RTS_World);
-    
-    FVector OutPosition;
-    FRotator OutRotation;
-
-    BlasterCharacter->GetMesh()->TransformToBoneSpace(FName("hand_r"), LeftHandTransform.GetLocation(), FRotator::ZeroRotator, OutPosition, OutRotation);
+    // Same result as USkinnedMeshComponent::TransformToBoneSpace, from the bone transform gathered on the game thread
+    const FTransform& HandBoneTransform = GatherData.RightHandBoneTransform;
 
-    LeftHandTransform.SetLocation(OutPosition);
-    LeftHandTransform.SetRotation(FQuat(OutRotation));
+    LeftHandTransform = GatherData.LeftHandSocketTransform;
+    LeftHandTransform.SetLocation(HandBoneTransform.InverseTransformPosition(GatherData.LeftHandSocketTransform.GetLocation()));
+    LeftHandTransform.SetRotation(HandBoneTransform.InverseTransformRotation(FQuat::Identity));
   }
 }
+
+void UBlasterAnimInstance::SetAnimLODTier(const FBlasterAnimLODTier& Tier)
+{
+  AnimLODTier = Tier;
+}
+
+FBlasterAnimUpdateCycles UBlasterAnimInstance::ConsumeUpdateCycles()
+{
+  FBlasterAnimUpdateCycles Result;
+  Result.GatherCycles = GatherCycles.exchange(0);
+  Result.ThreadSafeUpdateCycles = ThreadSafeUpdateCycles.exchange(0);
+  Result.NumGathers = NumGathers.exchange(0);
+  Result.NumThreadSafeUpdates = NumThreadSafeUpdates.exchange(0);
+  Result.NumWorkerUpdates = NumWorkerUpdates.exchange(0);
+  return Result;
+}
@@ -6,6 +6,67 @@
 #include "Animation/AnimInstance.h"
 #include "BlasterAnimInstance.generated.h"
 
+// What a character evaluates at a given animation LOD, tiers are configured on UBlasterTickSubsystem
+USTRUCT(BlueprintType)
+struct FBlasterAnimLODTier
+{
+	GENERATED_BODY()
+
+	// Characters up to this distance from the closest local view use the tier, 0 means unbounded
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	float MaxDistance = 0.f;
+
+	// Anim graph evaluations skipped between two evaluated frames
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	int32 FrameSkip = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bInterpolateSkippedFrames = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bUpdateLean = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bInterpolateYawOffset = true;
+
+	// Only drives UBlasterAnimInstance::bUseHandIK, the left hand target is updated on every tier
+	UPROPERTY(EditAnywhere, BlueprintReadOnly)
+	bool bUpdateHandIK = true;
+};
+
+// Everything the anim update needs from the character, copied on the game thread
+struct FBlasterAnimGatherData
+{
+	FVector Velocity = FVector::ZeroVector;
+	FVector Acceleration = FVector::ZeroVector;
+	FRotator AimRotation = FRotator::ZeroRotator;
+	FRotator ActorRotation = FRotator::ZeroRotator;
+	FTransform LeftHandSocketTransform;
+	FTransform RightHandBoneTransform;
+	float AO_Yaw = 0.f;
+	float AO_Pitch = 0.f;
+	bool bIsInAir = false;
+	bool bWeaponEquipped = false;
+	bool bIsCrouched = false;
+	bool bIsAiming = false;
+	bool bHasLeftHandTarget = false;
+	bool bUpdateLean = true;
+	bool bInterpolateYawOffset = true;
+};
+
+// Time spent in each half of the update by every anim instance since the last UBlasterAnimInstance::ConsumeUpdateCycles,
+// always zero in shipping builds
+struct FBlasterAnimUpdateCycles
+{
+	uint64 GatherCycles = 0;
+	uint64 ThreadSafeUpdateCycles = 0;
+	int32 NumGathers = 0;
+	int32 NumThreadSafeUpdates = 0;
+
+	// Thread safe updates that ran on a worker rather than on the game thread
+	int32 NumWorkerUpdates = 0;
+};
+
 /**
  * 
  */
@@ -18,7 +79,12 @@ public:
 
 	virtual void NativeInitializeAnimation() override;
 	virtual void NativeUpdateAnimation(float DeltaTime) override;
+	virtual void NativeThreadSafeUpdateAnimation(float DeltaTime) override;
 
+	void SetAnimLODTier(const FBlasterAnimLODTier& Tier);
+
+	// Returns the totals and starts over, see Blaster.Anim.UpdateCost
+	static FBlasterAnimUpdateCycles ConsumeUpdateCycles();
 
 private:
 
@@ -61,6 +127,14 @@ private:
 	FRotator CharacterRotation;
 	FRotator DeltaRotation;
 
+	FBlasterAnimGatherData GatherData;
+
 	UPROPERTY(BlueprintReadOnly, Category = Movement, meta = (AllowPrivateAccess = "true"))
 	FTransform LeftHandTransform;
+
+	// False on far LOD tiers, for a graph that blends the left hand IK out. LeftHandTransform stays valid either way
+	UPROPERTY(BlueprintReadOnly, Category = Movement, meta = (AllowPrivateAccess = "true"))
+	bool bUseHandIK = true;
+
+	FBlasterAnimLODTier AnimLODTier;
 };
@@ -5,59 +5,187 @@
 #include "GameFramework/SpringArmComponent.h"
 #include "Camera/CameraComponent.h"
 #include "GameFramework/CharacterMovementComponent.h"
-#include "Components/WidgetComponent.h"
 #include "Net/UnrealNetwork.h"
 #include "Blaster/Weapon/Weapon.h"
+#include "BlasterCharacterMovementComponent.h"
 #include "Blaster/BlasterComponents/CombatComponent.h"
+#include "Blaster/BlasterComponents/LagCompensationComponent.h"
+#include "Blaster/BlasterSubsystems/BlasterTickSubsystem.h"
 #include "Components/CapsuleComponent.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "Blaster/Blaster.h"
+#include "EngineUtils.h"
+#include "Serialization/ArchiveCountMem.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Push Compares Skipped (Character)"), STAT_BlasterPushSkippedCharacter, STATGROUP_Blaster);
+DECLARE_CYCLE_STAT(TEXT("Aim Offset"), STAT_BlasterAimOffset, STATGROUP_BlasterCharacter);
+DECLARE_CYCLE_STAT(TEXT("Update Aim State"), STAT_BlasterUpdateAimState, STATGROUP_BlasterCharacter);
+DECLARE_CYCLE_STAT(TEXT("OnRep Aim State"), STAT_BlasterOnRepAimState, STATGROUP_BlasterCharacter);
+
+static int64 CountObjectBytes(UObject* Object)
+{
+	FArchiveCountMem Count(Object);
+	return Count.GetMax() + Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+}
+
+template <typename ActorType>
+static void DumpActorMemory(UWorld* World, const TCHAR* Label)
+{
+	int32 NumActors = 0;
+	int64 TotalBytes = 0;
+	TMap<FName, int64> ComponentBytes;
+	for (TActorIterator<ActorType> It(World); It; ++It)
+	{
+		++NumActors;
+		TotalBytes += CountObjectBytes(*It);
+
+		for (UActorComponent* Component : It->GetComponents())
+		{
+			const int64 Bytes = CountObjectBytes(Component);
+			TotalBytes += Bytes;
+			ComponentBytes.FindOrAdd(Component->GetClass()->GetFName()) += Bytes;
+		}
+	}
+
+	if (NumActors == 0)
+	{
+		UE_LOG(LogBlaster, Display, TEXT("%s: none"), Label);
+		return;
+	}
+
+	UE_LOG(LogBlaster, Display, TEXT("%s: %d, %lld bytes each"), Label, NumActors, TotalBytes / NumActors);
+
+	ComponentBytes.ValueSort(TGreater<int64>());
+	for (const TPair<FName, int64>& Pair : ComponentBytes)
+		UE_LOG(LogBlaster, Display, TEXT("  %s: %lld bytes each"), *Pair.Key.ToString(), Pair.Value / NumActors);
+}
+
+static void DumpActorMemory(UWorld* World)
+{
+	if (!World)
+		return;
+
+	// Compare the output of a game and a server binary, or of a listen and a dedicated server, to see what stripping saves
+	UE_LOG(LogBlaster, Display, TEXT("Actor memory (%s, %s binary)"),
+		World->GetNetMode() == NM_DedicatedServer ? TEXT("dedicated server") : TEXT("not a dedicated server"),
+		UE_SERVER ? TEXT("server") : TEXT("game or editor"));
+	DumpActorMemory<ABlasterCharacter>(World, TEXT("Characters"));
+	DumpActorMemory<AWeapon>(World, TEXT("Weapons"));
+}
+
+static FAutoConsoleCommandWithWorld DumpActorMemoryCommand(
+	TEXT("Blaster.DumpActorMemory"),
+	TEXT("Logs the bytes per character and weapon, actor and components, broken down by component class"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&DumpActorMemory));
+
+FOnBlasterCharacterEquipWeapon ABlasterCharacter::NotifyEquipWeapon;
+FOnBlasterCharacterEquipWeapon ABlasterCharacter::NotifyUnEquipWeapon;
+
+// Cosmetic only, a dedicated server of any binary never creates them. The nameplate is drawn by ABlasterHUD.
+static const FObjectInitializer& SkipCosmeticSubobjects(const FObjectInitializer& ObjectInitializer)
+{
+	if (IsRunningDedicatedServer())
+		ObjectInitializer.DoNotCreateDefaultSubobject(TEXT("CameraBoom")).DoNotCreateDefaultSubobject(TEXT("FollowCamera"));
+
+	return ObjectInitializer;
+}
 
 // Sets default values
-ABlasterCharacter::ABlasterCharacter()
+ABlasterCharacter::ABlasterCharacter(const FObjectInitializer& ObjectInitializer)
+	: Super(SkipCosmeticSubobjects(ObjectInitializer).SetDefaultSubobjectClass<UBlasterCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
- 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Aim offset is updated in a batch by UBlasterTickSubsystem instead of per-actor Tick
+	PrimaryActorTick.bCanEverTick = false;
 
-	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
-	CameraBoom->SetupAttachment(GetMesh());
-	CameraBoom->TargetArmLength = 600.f;
-	CameraBoom->bUsePawnControlRotation = true;
+	// Null on dedicated servers, see SkipCosmeticSubobjects
+	CameraBoom = CreateOptionalDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
+	if (CameraBoom)
+	{
+		CameraBoom->SetupAttachment(GetMesh());
+		CameraBoom->TargetArmLength = 600.f;
+		CameraBoom->bUsePawnControlRotation = true;
+	}
 
-	FollowCamera = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
-	FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
-	FollowCamera->bUsePawnControlRotation = false;
+	FollowCamera = CreateOptionalDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
+	if (FollowCamera)
+	{
+		if (CameraBoom)
+			FollowCamera->SetupAttachment(CameraBoom, USpringArmComponent::SocketName);
+		else
+			FollowCamera->SetupAttachment(GetMesh());
+		FollowCamera->bUsePawnControlRotation = false;
+	}
 
 	bUseControllerRotationYaw = false;
 	GetCharacterMovement()->bOrientRotationToMovement = true;
 
-	OverheadWidget = CreateDefaultSubobject<UWidgetComponent>(TEXT("OverheadWidget"));
-	OverheadWidget->SetupAttachment(RootComponent);
-
 	Combat = CreateDefaultSubobject<UCombatComponent>(TEXT("CombatComponent"));
 	Combat->SetIsReplicated(true);
 
+	LagCompensation = CreateDefaultSubobject<ULagCompensationComponent>(TEXT("LagCompensation"));
+
 	GetCharacterMovement()->NavAgentProps.bCanCrouch = true;
 	GetCapsuleComponent()->SetCollisionResponseToChannel(ECollisionChannel::ECC_Camera, ECollisionResponse::ECR_Ignore);
 	GetMesh()->SetCollisionResponseToChannel(ECollisionChannel::ECC_Camera, ECollisionResponse::ECR_Ignore);
+	GetMesh()->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility, ECollisionResponse::ECR_Block);
+
+	// Evaluation rate is driven per anim LOD tier by UBlasterTickSubsystem
+	GetMesh()->bEnableUpdateRateOptimizations = true;
+
+	AimInterpSpeed = 20.f;
 }
 
 void ABlasterCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION(ABlasterCharacter, OverlappingWeapon, COND_OwnerOnly);
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	Params.Condition = COND_OwnerOnly;
+	DOREPLIFETIME_WITH_PARAMS_FAST(ABlasterCharacter, OverlappingWeapon, Params);
+
+	Params.Condition = COND_SkipOwner;
+	DOREPLIFETIME_WITH_PARAMS_FAST(ABlasterCharacter, AimState, Params);
+
+	// Both are carried by AimState
+	DISABLE_REPLICATED_PROPERTY(APawn, RemoteViewPitch);
+	DISABLE_REPLICATED_PROPERTY(ACharacter, bIsCrouched);
+}
+
+void ABlasterCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	INC_DWORD_STAT_BY(STAT_BlasterPushSkippedCharacter, PushModelTracker.ConsumeSkipped(PushProperty_MAX));
 }
 
 void ABlasterCharacter::BeginPlay()
 {
 	Super::BeginPlay();
+
+	// Lag compensation records hit boxes from the bones, so the server has to refresh them even though it never renders
+	if (HasAuthority())
+		GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPoseAndRefreshBones;
+
+	if (GetNetMode() == NM_DedicatedServer)
+		GetMesh()->bEnableUpdateRateOptimizations = false;
+
+	UBlasterTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UBlasterTickSubsystem>();
+	if (TickSubsystem)
+		TickSubsystem->RegisterCharacter(this);
 }
 
-void ABlasterCharacter::Tick(float DeltaTime)
+void ABlasterCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	Super::Tick(DeltaTime);
+	// A holder that dies or leaves drops its weapon instead of taking it along
+	if (EndPlayReason == EEndPlayReason::Destroyed && HasAuthority() && Combat)
+		Combat->DropWeapon();
+
+	UBlasterTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UBlasterTickSubsystem>();
+	if (TickSubsystem)
+		TickSubsystem->UnregisterCharacter(this);
 
-	AimOffset(DeltaTime);
+	Super::EndPlay(EndPlayReason);
 }
 
 void ABlasterCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -71,6 +199,9 @@ void ABlasterCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCo
 	PlayerInputComponent->BindAction("Aim", IE_Pressed,  this, &ABlasterCharacter::AimBtnPressed);
 	PlayerInputComponent->BindAction("Aim", IE_Released,  this, &ABlasterCharacter::AimBtnReleased);
 
+	PlayerInputComponent->BindAction("Fire", IE_Pressed,  this, &ABlasterCharacter::FireBtnPressed);
+	PlayerInputComponent->BindAction("Fire", IE_Released,  this, &ABlasterCharacter::FireBtnReleased);
+
 	PlayerInputComponent->BindAxis("MoveForward", this, &ABlasterCharacter::MoveForward);
 	PlayerInputComponent->BindAxis("MoveRight", this, &ABlasterCharacter::MoveRight);
 	PlayerInputComponent->BindAxis("Turn", this, &ABlasterCharacter::Turn);
@@ -83,6 +214,9 @@ void ABlasterCharacter::PostInitializeComponents()
 
 	if (Combat)
 		Combat->Character = this;
+
+	if (LagCompensation)
+		LagCompensation->Character = this;
 }
 
 void ABlasterCharacter::MoveForward(float Value)
@@ -124,7 +258,7 @@ void ABlasterCharacter::EquipBtnPressed()
 		if (HasAuthority())
 			Combat->EquipWeapon(OverlappingWeapon);
 		else
-			ServerEquipButtonPressed();
+			Combat->PredictEquipWeapon(OverlappingWeapon);
 	}
 }
 
@@ -148,8 +282,27 @@ void ABlasterCharacter::AimBtnReleased()
 		Combat->SetAiming(false);
 }
 
+void ABlasterCharacter::FireBtnPressed()
+{
+	if (Combat)
+		Combat->FireButtonPressed(true);
+}
+
+void ABlasterCharacter::FireBtnReleased()
+{
+	if (Combat)
+		Combat->FireButtonPressed(false);
+}
+
 void ABlasterCharacter::AimOffset(float DeltaTime)
 {
+	BLASTER_SCOPE_CYCLE_COUNTER(STAT_BlasterAimOffset, BlasterCharacterChannel);
+
+	if (HasAuthority())
+		UpdateAimState();
+	else if (GetLocalRole() == ROLE_SimulatedProxy)
+		InterpolatedAimRotation = FMath::RInterpTo(InterpolatedAimRotation, AimState.GetAimRotation(), DeltaTime, AimInterpSpeed);
+
 	if (Combat && Combat->EquippedWeapon == nullptr)
 		return;
 
@@ -177,10 +330,44 @@ void ABlasterCharacter::AimOffset(float DeltaTime)
 	AO_Pitch = GetBaseAimRotation().Pitch;
 }
 
-void ABlasterCharacter::ServerEquipButtonPressed_Implementation()
+void ABlasterCharacter::UpdateAimState()
+{
+	BLASTER_SCOPE_CYCLE_COUNTER(STAT_BlasterUpdateAimState, BlasterCharacterChannel);
+
+	FBlasterAimState NewAimState;
+	NewAimState.SetAimRotation(GetBaseAimRotation());
+	NewAimState.SetAiming(IsAiming());
+	NewAimState.SetCrouched(bIsCrouched);
+
+	// Compared after quantization so sub-precision jitter does not dirty the property
+	if (NewAimState == AimState)
+		return;
+
+	AimState = NewAimState;
+	MARK_PROPERTY_DIRTY_FROM_NAME(ABlasterCharacter, AimState, this);
+	PushModelTracker.MarkDirty(PushProperty_AimState);
+}
+
+void ABlasterCharacter::OnRep_AimState()
 {
+	BLASTER_SCOPE_CYCLE_COUNTER(STAT_BlasterOnRepAimState, BlasterCharacterChannel);
+
 	if (Combat)
-		Combat->EquipWeapon(OverlappingWeapon);
+		Combat->bIsAiming = AimState.IsAiming();
+
+	if (bIsCrouched != AimState.IsCrouched())
+	{
+		bIsCrouched = AimState.IsCrouched();
+		OnRep_IsCrouched();
+	}
+}
+
+FRotator ABlasterCharacter::GetBaseAimRotation() const
+{
+	if (GetLocalRole() == ROLE_SimulatedProxy)
+		return InterpolatedAimRotation;
+
+	return Super::GetBaseAimRotation();
 }
 
 void ABlasterCharacter::OnRep_OverlappingWeapon(AWeapon * LastWeapon)
@@ -207,6 +394,8 @@ void ABlasterCharacter::SetOverlappingWeapon(AWeapon* Weapon)
 		OverlappingWeapon->ShowPickupWidget(false);
 
 	OverlappingWeapon = Weapon;
+	MARK_PROPERTY_DIRTY_FROM_NAME(ABlasterCharacter, OverlappingWeapon, this);
+	PushModelTracker.MarkDirty(PushProperty_OverlappingWeapon);
 	if (IsLocallyControlled())
 	{
 		if(OverlappingWeapon)
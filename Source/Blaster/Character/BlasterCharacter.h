@@ -4,22 +4,35 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "Blaster/BlasterNet/BlasterPushModel.h"
+#include "BlasterAimState.h"
 #include "BlasterCharacter.generated.h"
 
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnBlasterCharacterEquipWeapon, class ABlasterCharacter*, class AWeapon*);
+
 UCLASS()
 class BLASTER_API ABlasterCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
 public:
-	ABlasterCharacter();
-	virtual void Tick(float DeltaTime) override;
+	ABlasterCharacter(const FObjectInitializer& ObjectInitializer);
+	friend class UBlasterTickSubsystem;
+	friend class UBlasterBotComponent;
+	friend class UBlasterBenchmarkCommandlet;
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+	virtual FRotator GetBaseAimRotation() const override;
 	virtual void PostInitializeComponents() override;
 
+	// Server side, lets the replication graph make the weapon a dependent of its holder
+	static FOnBlasterCharacterEquipWeapon NotifyEquipWeapon;
+	static FOnBlasterCharacterEquipWeapon NotifyUnEquipWeapon;
+
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	void MoveForward(float Value);
 	void MoveRight(float Value);
@@ -29,7 +42,10 @@ protected:
 	void CrouchBtnPressed();
 	void AimBtnPressed();
 	void AimBtnReleased();
+	void FireBtnPressed();
+	void FireBtnReleased();
 	void AimOffset(float DeltaTime);
+	void UpdateAimState();
 
 private:
 	UPROPERTY(VisibleAnywhere, Category = "Camera")
@@ -38,8 +54,9 @@ private:
 	UPROPERTY(VisibleAnywhere, Category = "Camera")
 	class UCameraComponent* FollowCamera;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
-	class UWidgetComponent* OverheadWidget;
+	// Never created since nameplates moved to ABlasterHUD, kept until the Blueprints that read it are re-saved
+	UPROPERTY(BlueprintReadOnly, meta = (AllowPrivateAccess = "true", DeprecatedProperty, DeprecationMessage = "Nameplates are drawn by ABlasterHUD"))
+	class UWidgetComponent* OverheadWidget_DEPRECATED;
 
 	UPROPERTY(ReplicatedUsing = OnRep_OverlappingWeapon)
 	class AWeapon* OverlappingWeapon;
@@ -50,19 +67,37 @@ private:
 	UPROPERTY(VisibleAnywhere)
 	class UCombatComponent* Combat;
 
-	UFUNCTION(Server, Reliable)
-	void ServerEquipButtonPressed();
+	UPROPERTY(VisibleAnywhere)
+	class ULagCompensationComponent* LagCompensation;
+
+	// Replaces RemoteViewPitch, bIsCrouched and the aiming flag for simulated proxies
+	UPROPERTY(ReplicatedUsing = OnRep_AimState)
+	FBlasterAimState AimState;
+
+	UFUNCTION()
+	void OnRep_AimState();
+
+	// Simulated proxies ease towards the last replicated aim rotation at this speed
+	UPROPERTY(EditAnywhere, Category = "Aim")
+	float AimInterpSpeed;
+
+	FRotator InterpolatedAimRotation;
 
 	float AO_Yaw;
 	float AO_Pitch;
 	FRotator StartingAimRotation;
 
+	enum EPushProperty { PushProperty_OverlappingWeapon, PushProperty_AimState, PushProperty_MAX };
+	FBlasterPushModelTracker PushModelTracker;
+
 public:
   bool IsWeaponEquipped();
   bool IsAiming();
   void SetOverlappingWeapon(AWeapon* Weapon);
+	FORCEINLINE AWeapon* GetOverlappingWeapon() const { return OverlappingWeapon; }
 
 	FORCEINLINE float GetAO_Yaw() const { return AO_Yaw; }
 	FORCEINLINE float GetAO_Pitch() const { return AO_Pitch; }
 	AWeapon* GetEquippedWeapon();
+	FORCEINLINE ULagCompensationComponent* GetLagCompensation() const { return LagCompensation; }
 };
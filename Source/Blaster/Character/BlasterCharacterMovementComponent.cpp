@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterCharacterMovementComponent.h"
+#include "GameFramework/Character.h"
+#include "Blaster/Blaster.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Movement Corrections Received"), STAT_BlasterMovementCorrections, STATGROUP_Blaster);
+
+UBlasterCharacterMovementComponent::UBlasterCharacterMovementComponent()
+{
+	MaxWalkSpeedAiming = 300.f;
+	bWantsToAim = false;
+	NumCorrectionsReceived = 0;
+}
+
+float UBlasterCharacterMovementComponent::GetMaxSpeed() const
+{
+	if (bWantsToAim && MovementMode == MOVE_Walking && !IsCrouching())
+		return MaxWalkSpeedAiming;
+
+	return Super::GetMaxSpeed();
+}
+
+void UBlasterCharacterMovementComponent::SetWantsToAim(bool bInWantsToAim)
+{
+	bWantsToAim = bInWantsToAim;
+}
+
+void UBlasterCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	bWantsToAim = (Flags & FSavedMove_Character::FLAG_Custom_0) != 0;
+}
+
+FNetworkPredictionData_Client* UBlasterCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		UBlasterCharacterMovementComponent* MutableThis = const_cast<UBlasterCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Blaster(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UBlasterCharacterMovementComponent::OnClientCorrectionReceived(FNetworkPredictionData_Client_Character& ClientData, float TimeStamp, FVector NewLocation, FVector NewVelocity, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode)
+{
+	Super::OnClientCorrectionReceived(ClientData, TimeStamp, NewLocation, NewVelocity, NewBase, NewBaseBoneName, bHasBase, bBaseRelativePosition, ServerMovementMode);
+
+	++NumCorrectionsReceived;
+	INC_DWORD_STAT(STAT_BlasterMovementCorrections);
+}
+
+void FSavedMove_Blaster::Clear()
+{
+	Super::Clear();
+
+	bSavedWantsToAim = false;
+}
+
+uint8 FSavedMove_Blaster::GetCompressedFlags() const
+{
+	uint8 Result = Super::GetCompressedFlags();
+
+	if (bSavedWantsToAim)
+		Result |= FLAG_Custom_0;
+
+	return Result;
+}
+
+bool FSavedMove_Blaster::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	// Moves on either side of an aim change run at different speeds
+	if (bSavedWantsToAim != static_cast<FSavedMove_Blaster*>(NewMove.Get())->bSavedWantsToAim)
+		return false;
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+void FSavedMove_Blaster::SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+
+	const UBlasterCharacterMovementComponent* MovementComponent = Cast<UBlasterCharacterMovementComponent>(C->GetCharacterMovement());
+	if (MovementComponent)
+		bSavedWantsToAim = MovementComponent->bWantsToAim;
+}
+
+void FSavedMove_Blaster::PrepMoveFor(ACharacter* C)
+{
+	Super::PrepMoveFor(C);
+
+	UBlasterCharacterMovementComponent* MovementComponent = Cast<UBlasterCharacterMovementComponent>(C->GetCharacterMovement());
+	if (MovementComponent)
+		MovementComponent->bWantsToAim = bSavedWantsToAim;
+}
+
+FNetworkPredictionData_Client_Blaster::FNetworkPredictionData_Client_Blaster(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Blaster::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_Blaster());
+}
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "BlasterCharacterMovementComponent.generated.h"
+
+/**
+ * Carries the aim state in the saved moves, so the slower aim walk speed is predicted by the
+ * owning client and replayed by the server with the move it belongs to. Crouching already travels
+ * the same way through the engine's FLAG_WantsToCrouch.
+ */
+UCLASS()
+class BLASTER_API UBlasterCharacterMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	UBlasterCharacterMovementComponent();
+
+	virtual float GetMaxSpeed() const override;
+	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+	virtual void OnClientCorrectionReceived(class FNetworkPredictionData_Client_Character& ClientData, float TimeStamp, FVector NewLocation, FVector NewVelocity, UPrimitiveComponent* NewBase, FName NewBaseBoneName, bool bHasBase, bool bBaseRelativePosition, uint8 ServerMovementMode) override;
+
+	// Only to be called for a locally controlled character, the server gets it through the saved moves
+	void SetWantsToAim(bool bInWantsToAim);
+	FORCEINLINE bool WantsToAim() const { return bWantsToAim; }
+
+	FORCEINLINE int32 GetNumCorrectionsReceived() const { return NumCorrectionsReceived; }
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Character Movement: Walking")
+	float MaxWalkSpeedAiming;
+
+protected:
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+
+private:
+	friend class FSavedMove_Blaster;
+
+	bool bWantsToAim;
+
+	int32 NumCorrectionsReceived;
+};
+
+class FSavedMove_Blaster : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	FSavedMove_Blaster()
+		: bSavedWantsToAim(false)
+	{
+	}
+
+	virtual void Clear() override;
+	virtual uint8 GetCompressedFlags() const override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual void PrepMoveFor(ACharacter* C) override;
+
+	uint8 bSavedWantsToAim : 1;
+};
+
+class FNetworkPredictionData_Client_Blaster : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_Blaster(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
@@ -3,6 +3,12 @@
 
 #include "LobbyGameMode.h"
 #include "GameFramework/GameStateBase.h"
+#include "Blaster/HUD/BlasterHUD.h"
+
+ALobbyGameMode::ALobbyGameMode()
+{
+  HUDClass = ABlasterHUD::StaticClass();
+}
 
 void ALobbyGameMode::PostLogin(APlayerController* NewPlayer)
 {
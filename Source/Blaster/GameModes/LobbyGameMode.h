@@ -14,6 +14,9 @@ class BLASTER_API ALobbyGameMode : public AGameMode
 {
 	GENERATED_BODY()
 
+public:
+	ALobbyGameMode();
+
 
 	virtual void PostLogin(APlayerController* NewPlayer) override;
 
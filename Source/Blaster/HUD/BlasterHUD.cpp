@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlasterHUD.h"
+#include "OverheadWidget.h"
+#include "Blaster/Blaster.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/Weapon/Weapon.h"
+#include "Blaster/BlasterSubsystems/BlasterTickSubsystem.h"
+#include "Blueprint/UserWidget.h"
+#include "Engine/GameViewportClient.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "SceneView.h"
+
+DECLARE_CYCLE_STAT(TEXT("HUD Nameplates"), STAT_BlasterHUDNameplates, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Nameplates Shown"), STAT_BlasterNameplatesShown, STATGROUP_Blaster);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Nameplate Text Updates"), STAT_BlasterNameplateTextUpdates, STATGROUP_Blaster);
+
+void ABlasterHUD::BeginPlay()
+{
+	Super::BeginPlay();
+
+	NameplateClass = NameplateWidgetClass.LoadSynchronous();
+
+	UClass* PromptClass = PickupPromptWidgetClass.LoadSynchronous();
+	if (PromptClass && PlayerOwner)
+	{
+		PickupPrompt = CreateWidget<UUserWidget>(PlayerOwner, PromptClass);
+		if (PickupPrompt)
+		{
+			PickupPrompt->SetAlignmentInViewport(FVector2D(0.5f, 1.f));
+			PickupPrompt->SetVisibility(ESlateVisibility::Collapsed);
+			PickupPrompt->AddToViewport(-1);
+		}
+	}
+}
+
+void ABlasterHUD::DrawHUD()
+{
+	Super::DrawHUD();
+
+	SCOPE_CYCLE_COUNTER(STAT_BlasterHUDNameplates);
+
+	if (!UpdateViewProjection())
+		return;
+
+	UpdateNameplates();
+	UpdatePickupPrompt();
+}
+
+void ABlasterHUD::ShowPickupPrompt(AWeapon* Weapon, bool bShow)
+{
+	if (bShow)
+		PickupPromptWeapon = Weapon;
+	else if (PickupPromptWeapon == Weapon)
+		PickupPromptWeapon.Reset();
+}
+
+bool ABlasterHUD::UpdateViewProjection()
+{
+	ULocalPlayer* LocalPlayer = PlayerOwner ? PlayerOwner->GetLocalPlayer() : nullptr;
+	if (!LocalPlayer || !LocalPlayer->ViewportClient)
+		return false;
+
+	FSceneViewProjectionData ProjectionData;
+	if (!LocalPlayer->GetProjectionData(LocalPlayer->ViewportClient->Viewport, ProjectionData))
+		return false;
+
+	ViewProjectionMatrix = ProjectionData.ComputeViewProjectionMatrix();
+	ViewRect = ProjectionData.GetConstrainedViewRect();
+	ViewLocation = ProjectionData.ViewOrigin;
+	return true;
+}
+
+bool ABlasterHUD::ProjectToViewport(const FVector& WorldLocation, FVector2D& OutPosition) const
+{
+	// What UGameplayStatics::ProjectWorldToScreen does, without building the projection again for every call
+	return FSceneView::ProjectWorldToScreen(WorldLocation, ViewRect, ViewProjectionMatrix, OutPosition);
+}
+
+void ABlasterHUD::UpdateNameplates()
+{
+	UBlasterTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UBlasterTickSubsystem>();
+
+	int32 NumShown = 0;
+	if (TickSubsystem && NameplateClass)
+	{
+		const float MaxDistanceSquared = FMath::Square(MaxNameplateDistance);
+		for (ABlasterCharacter* Character : TickSubsystem->GetCharacters())
+		{
+			const APlayerState* CharacterPlayerState = Character->GetPlayerState();
+			if (!CharacterPlayerState || Character->IsLocallyControlled())
+				continue;
+
+			const FVector Location = Character->GetActorLocation() + FVector(0.f, 0.f, NameplateHeight);
+			if (FVector::DistSquared(Location, ViewLocation) > MaxDistanceSquared)
+				continue;
+
+			// The renderer has already done occlusion culling, a character it skipped is behind something
+			if (!Character->WasRecentlyRendered(0.1f))
+				continue;
+
+			FVector2D Position;
+			if (!ProjectToViewport(Location, Position))
+				continue;
+
+			UUserWidget* Nameplate = GetNameplate(NumShown);
+			if (!Nameplate)
+				break;
+
+			const FString PlayerName = CharacterPlayerState->GetPlayerName();
+			if (NameplateTexts[NumShown] != PlayerName)
+			{
+				NameplateTexts[NumShown] = PlayerName;
+				INC_DWORD_STAT(STAT_BlasterNameplateTextUpdates);
+
+				UOverheadWidget* OverheadWidget = Cast<UOverheadWidget>(Nameplate);
+				if (OverheadWidget)
+					OverheadWidget->SetDisplayText(PlayerName);
+			}
+
+			Nameplate->SetPositionInViewport(Position);
+			if (NumShown >= NumShownNameplates)
+				Nameplate->SetVisibility(ESlateVisibility::HitTestInvisible);
+
+			++NumShown;
+		}
+	}
+
+	for (int32 Index = NumShown; Index < NumShownNameplates; ++Index)
+		Nameplates[Index]->SetVisibility(ESlateVisibility::Collapsed);
+
+	NumShownNameplates = NumShown;
+	INC_DWORD_STAT_BY(STAT_BlasterNameplatesShown, NumShown);
+}
+
+UUserWidget* ABlasterHUD::GetNameplate(int32 Index)
+{
+	if (Nameplates.IsValidIndex(Index))
+		return Nameplates[Index];
+
+	// The pool only grows to the most nameplates ever on screen at once
+	UUserWidget* Nameplate = CreateWidget<UUserWidget>(PlayerOwner, NameplateClass);
+	if (!Nameplate)
+		return nullptr;
+
+	Nameplate->SetAlignmentInViewport(FVector2D(0.5f, 1.f));
+	Nameplate->SetVisibility(ESlateVisibility::Collapsed);
+	Nameplate->AddToViewport(-1);
+
+	Nameplates.Add(Nameplate);
+	NameplateTexts.AddDefaulted();
+	return Nameplate;
+}
+
+void ABlasterHUD::UpdatePickupPrompt()
+{
+	if (!PickupPrompt)
+		return;
+
+	const AWeapon* Weapon = PickupPromptWeapon.Get();
+
+	FVector2D Position;
+	const bool bShow = Weapon && ProjectToViewport(Weapon->GetActorLocation() + FVector(0.f, 0.f, PickupPromptHeight), Position);
+	if (bShow)
+		PickupPrompt->SetPositionInViewport(Position);
+
+	const ESlateVisibility Visibility = bShow ? ESlateVisibility::HitTestInvisible : ESlateVisibility::Collapsed;
+	if (PickupPrompt->GetVisibility() != Visibility)
+		PickupPrompt->SetVisibility(Visibility);
+}
@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/HUD.h"
+#include "BlasterHUD.generated.h"
+
+class AWeapon;
+class UUserWidget;
+
+/**
+ * Draws the nameplates of other characters and the pickup prompt of the overlapped weapon as screen space
+ * widgets, in place of a world space widget component on every character and weapon.
+ *
+ * Nameplate widgets are pooled and positioned in one pass per frame with a single view projection.
+ * Characters that are too far away, off screen or were not rendered recently (occluded) get none, and
+ * a nameplate's text is only set when the player name changes.
+ */
+UCLASS(Config = Game)
+class BLASTER_API ABlasterHUD : public AHUD
+{
+	GENERATED_BODY()
+
+public:
+	virtual void DrawHUD() override;
+
+	void ShowPickupPrompt(AWeapon* Weapon, bool bShow);
+
+protected:
+	virtual void BeginPlay() override;
+
+private:
+	bool UpdateViewProjection();
+	bool ProjectToViewport(const FVector& WorldLocation, FVector2D& OutPosition) const;
+	void UpdateNameplates();
+	void UpdatePickupPrompt();
+	UUserWidget* GetNameplate(int32 Index);
+
+	UPROPERTY(Config)
+	TSoftClassPtr<UUserWidget> NameplateWidgetClass;
+
+	UPROPERTY(Config)
+	TSoftClassPtr<UUserWidget> PickupPromptWidgetClass;
+
+	UPROPERTY(Config)
+	float MaxNameplateDistance = 3000.f;
+
+	// Above the character's capsule center
+	UPROPERTY(Config)
+	float NameplateHeight = 110.f;
+
+	// Above the weapon's origin
+	UPROPERTY(Config)
+	float PickupPromptHeight = 40.f;
+
+	UPROPERTY()
+	TSubclassOf<UUserWidget> NameplateClass;
+
+	UPROPERTY()
+	TArray<UUserWidget*> Nameplates;
+
+	// Parallel to Nameplates, the text last set on each
+	TArray<FString> NameplateTexts;
+
+	// Nameplates shown during the last pass, the rest of the pool is collapsed
+	int32 NumShownNameplates = 0;
+
+	UPROPERTY()
+	UUserWidget* PickupPrompt;
+
+	TWeakObjectPtr<AWeapon> PickupPromptWeapon;
+
+	FMatrix ViewProjectionMatrix;
+	FIntRect ViewRect;
+	FVector ViewLocation;
+};
@@ -4,7 +4,7 @@
 #include "OverheadWidget.h"
 #include "Components/TextBlock.h"
 
-void UOverheadWidget::SetDisplayText(FString TextToDisplay)
+void UOverheadWidget::SetDisplayText(const FString& TextToDisplay)
 {
   if (DisplayText)
     DisplayText->SetText(FText::FromString(TextToDisplay));
@@ -12,30 +12,8 @@ void UOverheadWidget::SetDisplayText(FString TextToDisplay)
 
 void UOverheadWidget::ShowPlayerNetRole(APawn* InPawn)
 {
-  ENetRole RemoteRole = InPawn->GetRemoteRole();
-  FString Role;
-
-  switch (RemoteRole)
-  {
-  case ROLE_None:
-    Role = FString("None");
-    break;
-  case ROLE_SimulatedProxy:
-    Role = FString("Simulate Proxy");
-    break;
-  case ROLE_AutonomousProxy:
-    Role = FString("Autonomous Proxy");
-    break;
-  case ROLE_Authority:
-    Role = FString("Authority");
-    break;
-  default:
-    Role = FString("None");
-    break;
-  }
-
-  //FString RemoteRoleString = FString::Printf(TEXT("Local Role: %s"), *Role);
-  SetDisplayText("");
+  // The role was never shown, nameplates carry the player name set by ABlasterHUD
+  SetDisplayText(FString());
 }
 
 void UOverheadWidget::NativeDestruct()
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "Blaster/Character/BlasterAnimInstance.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace BlasterAnimTests
+{
+	static constexpr int32 NumCharacters = 32;
+	static constexpr int32 NumWarmUpFrames = 10;
+	static constexpr int32 NumFrames = 60;
+	static constexpr float DeltaTime = 1.f / 30.f;
+
+	// The native character has no anim graph, this is the Blueprint the benchmark commandlet spawns too
+	static const TCHAR* CharacterClassPath = TEXT("/Game/Blueprints/BlasterCharacter_BP.BlasterCharacter_BP_C");
+
+	static void TickWorld(UWorld* World)
+	{
+		World->Tick(LEVELTICK_All, DeltaTime);
+
+		// Normally advanced by the engine loop, update rate optimizations pick the frames to skip from it
+		++GFrameCounter;
+	}
+
+	static double CyclesToMsPerFrame(uint64 Cycles)
+	{
+		return FPlatformTime::ToMilliseconds64(Cycles) / NumFrames;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlasterAnimUpdateCostTest, "Blaster.Anim.UpdateCost",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+// Ticks the characters' meshes through the world tick, so the thread safe half is dispatched the way it is in game
+bool FBlasterAnimUpdateCostTest::RunTest(const FString& Parameters)
+{
+	using namespace BlasterAnimTests;
+
+	UClass* CharacterClass = TSoftClassPtr<ABlasterCharacter>(FSoftObjectPath(CharacterClassPath)).LoadSynchronous();
+	if (!TestNotNull(TEXT("Character Blueprint"), CharacterClass))
+		return false;
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("BlasterAnimTest"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// A loose grid so no two characters share a spot
+	const int32 Columns = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(NumCharacters)));
+	int32 NumAnimated = 0;
+	for (int32 Index = 0; Index < NumCharacters; ++Index)
+	{
+		const FVector Location((Index % Columns) * 300.f, (Index / Columns) * 300.f, 100.f);
+		const ABlasterCharacter* Character = World->SpawnActor<ABlasterCharacter>(CharacterClass, Location, FRotator::ZeroRotator, SpawnParams);
+		if (Character && Character->GetMesh() && Cast<UBlasterAnimInstance>(Character->GetMesh()->GetAnimInstance()))
+			++NumAnimated;
+	}
+
+	TestEqual(TEXT("Characters with a Blaster anim instance"), NumAnimated, NumCharacters);
+
+	for (int32 Frame = 0; Frame < NumWarmUpFrames; ++Frame)
+		TickWorld(World);
+
+	UBlasterAnimInstance::ConsumeUpdateCycles();
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		TickWorld(World);
+
+	const uint64 WorldTickCycles = FPlatformTime::Cycles64() - StartCycles;
+	const FBlasterAnimUpdateCycles Cycles = UBlasterAnimInstance::ConsumeUpdateCycles();
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	// Anim Gather is game thread time, Anim Thread Safe Update is summed over whichever threads ran it
+	AddInfo(FString::Printf(TEXT("%d characters, %d frames: Anim Gather %.4f ms/frame on the game thread, Anim Thread Safe Update %.4f ms/frame (%d of %d on workers), world tick %.4f ms/frame"),
+		NumAnimated, NumFrames, CyclesToMsPerFrame(Cycles.GatherCycles), CyclesToMsPerFrame(Cycles.ThreadSafeUpdateCycles),
+		Cycles.NumWorkerUpdates, Cycles.NumThreadSafeUpdates, CyclesToMsPerFrame(WorldTickCycles)));
+
+	TestTrue(TEXT("Gather ran"), Cycles.NumGathers > 0);
+	TestTrue(TEXT("Thread safe update ran"), Cycles.NumThreadSafeUpdates > 0);
+
+	if (Cycles.NumWorkerUpdates == 0)
+		AddWarning(TEXT("No thread safe update ran on a worker, parallel anim update is off (a.ParallelAnimUpdate) or there are no worker threads"));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "Blaster/BlasterComponents/CombatComponent.h"
+#include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/Weapon/Weapon.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace BlasterCombatTests
+{
+	// A standalone game world with one character, torn down when it goes out of scope
+	struct FTestWorld
+	{
+		UWorld* World = nullptr;
+		ABlasterCharacter* Character = nullptr;
+		UCombatComponent* Combat = nullptr;
+
+		FTestWorld()
+		{
+			World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("BlasterCombatTest"));
+			FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+			WorldContext.SetCurrentWorld(World);
+			World->InitializeActorsForPlay(FURL());
+			World->BeginPlay();
+
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			Character = World->SpawnActor<ABlasterCharacter>(ABlasterCharacter::StaticClass(), FVector::ZeroVector, FRotator::ZeroRotator, SpawnParams);
+			Combat = Character ? Character->FindComponentByClass<UCombatComponent>() : nullptr;
+		}
+
+		~FTestWorld()
+		{
+			GEngine->DestroyWorldContext(World);
+			World->DestroyWorld(false);
+		}
+
+		AWeapon* SpawnWeapon(const FVector& Location) const
+		{
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			return World->SpawnActor<AWeapon>(AWeapon::StaticClass(), Location, FRotator::ZeroRotator, SpawnParams);
+		}
+	};
+
+	// The native character has no hand socket, attach by hand so the rollback has something to undo
+	static void EnsureHeld(ABlasterCharacter* Character, AWeapon* Weapon)
+	{
+		if (Weapon->GetAttachParentActor() != Character)
+			Weapon->AttachToComponent(Character->GetMesh(), FAttachmentTransformRules::SnapToTargetNotIncludingScale);
+	}
+
+	static FBlasterInputPacket MakePacket(uint16 LastSequence, std::initializer_list<uint8> Buttons)
+	{
+		FBlasterInputPacket Packet;
+		Packet.LastSequence = LastSequence;
+		for (uint8 FrameButtons : Buttons)
+			Packet.Buttons[Packet.NumFrames++] = FrameButtons;
+		return Packet;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlasterCombatReconcileTest, "Blaster.Combat.Reconcile",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBlasterCombatReconcileTest::RunTest(const FString& Parameters)
+{
+	using namespace BlasterCombatTests;
+
+	FTestWorld TestWorld;
+	if (!TestNotNull(TEXT("Combat component"), TestWorld.Combat))
+		return false;
+
+	ABlasterCharacter* Character = TestWorld.Character;
+	UCombatComponent* Combat = TestWorld.Combat;
+	const UCharacterMovementComponent* Movement = Character->GetCharacterMovement();
+
+	// Refused equip: the server acks the sequence with empty hands
+	const FVector StartA(500.f, 0.f, 0.f);
+	AWeapon* WeaponA = TestWorld.SpawnWeapon(StartA);
+	const FBlasterPredictedAction* Action = Combat->ApplyPredictedEquip(WeaponA);
+	if (!TestNotNull(TEXT("Predicted action"), Action))
+		return false;
+
+	EnsureHeld(Character, WeaponA);
+	TestEqual(TEXT("Predicted weapon is equipped"), Combat->EquippedWeapon, WeaponA);
+	TestTrue(TEXT("Predicted equip faces the aim"), Character->bUseControllerRotationYaw);
+
+	Combat->CombatAck.Sequence = Action->Sequence;
+	Combat->CombatAck.EquippedWeapon = nullptr;
+	Combat->OnRep_CombatAck();
+
+	TestNull(TEXT("Refused weapon is unequipped"), Combat->EquippedWeapon);
+	TestNull(TEXT("Refused weapon is detached"), WeaponA->GetAttachParentActor());
+	TestTrue(TEXT("Refused weapon is back where it was"), WeaponA->GetActorLocation().Equals(StartA));
+	TestTrue(TEXT("Unarmed orients to movement"), Movement->bOrientRotationToMovement);
+	TestFalse(TEXT("Unarmed ignores controller yaw"), Character->bUseControllerRotationYaw);
+	TestEqual(TEXT("Nothing pending"), Combat->NumPendingActions, 0);
+
+	// Lost ack: two equips in flight, only the second one is acknowledged and it refuses the first
+	const FVector StartB(-500.f, 0.f, 0.f);
+	AWeapon* WeaponB = TestWorld.SpawnWeapon(StartB);
+
+	Combat->ApplyPredictedEquip(WeaponA);
+	EnsureHeld(Character, WeaponA);
+	const FBlasterPredictedAction* ActionB = Combat->ApplyPredictedEquip(WeaponB);
+	EnsureHeld(Character, WeaponB);
+	TestEqual(TEXT("Two equips pending"), Combat->NumPendingActions, 2);
+
+	// A stale ack must not undo anything
+	const uint16 SequenceB = ActionB->Sequence;
+	Combat->CombatAck.Sequence = static_cast<uint16>(SequenceB - 2);
+	Combat->CombatAck.EquippedWeapon = nullptr;
+	Combat->OnRep_CombatAck();
+	TestEqual(TEXT("Stale ack keeps the newest prediction"), Combat->EquippedWeapon, WeaponB);
+	TestEqual(TEXT("Stale ack keeps both pending"), Combat->NumPendingActions, 2);
+
+	Combat->CombatAck.Sequence = SequenceB;
+	Combat->CombatAck.EquippedWeapon = WeaponB;
+	Combat->OnRep_CombatAck();
+
+	TestEqual(TEXT("Confirmed weapon stays equipped"), Combat->EquippedWeapon, WeaponB);
+	TestNull(TEXT("Superseded weapon is detached"), WeaponA->GetAttachParentActor());
+	TestTrue(TEXT("Superseded weapon is back where it was"), WeaponA->GetActorLocation().Equals(StartA));
+	TestTrue(TEXT("Armed faces the aim"), Character->bUseControllerRotationYaw);
+	TestEqual(TEXT("Nothing pending after the ack"), Combat->NumPendingActions, 0);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlasterCombatInputLossTest, "Blaster.Combat.InputLoss",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBlasterCombatInputLossTest::RunTest(const FString& Parameters)
+{
+	using namespace BlasterCombatTests;
+
+	FTestWorld TestWorld;
+	if (!TestNotNull(TEXT("Combat component"), TestWorld.Combat))
+		return false;
+
+	// The character has authority in a standalone world, so it plays the server's side
+	UCombatComponent* Server = TestWorld.Combat;
+
+	// Packets repeat the unacknowledged frames, the second one is lost and the third covers it
+	const FBlasterInputPacket First = MakePacket(2, { InputButton_Aim, InputButton_Aim | InputButton_Fire });
+	const FBlasterInputPacket Third = MakePacket(4, { InputButton_Aim | InputButton_Fire, InputButton_Fire, 0 });
+
+	Server->ServerCombatInput_Implementation(First);
+	TestEqual(TEXT("First packet applied"), Server->LastInputSequence, static_cast<uint16>(2));
+	TestTrue(TEXT("Aiming after the first packet"), Server->bIsAiming);
+	TestTrue(TEXT("Firing after the first packet"), Server->bFireButtonPressed);
+
+	// Through the wire format, as the packet would arrive
+	FBitWriter Writer(0, true);
+	bool bSuccess = false;
+	FBlasterInputPacket(Third).NetSerialize(Writer, nullptr, bSuccess);
+	TestTrue(TEXT("Packet serializes"), bSuccess);
+
+	FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+	FBlasterInputPacket Received;
+	Received.NetSerialize(Reader, nullptr, bSuccess);
+	TestTrue(TEXT("Packet deserializes"), bSuccess);
+	TestEqual(TEXT("Frames survive serialization"), static_cast<int32>(Received.NumFrames), 3);
+
+	Server->ServerCombatInput_Implementation(Received);
+	TestEqual(TEXT("Lost frame recovered"), Server->LastInputSequence, static_cast<uint16>(4));
+	TestFalse(TEXT("Aim released"), Server->bIsAiming);
+	TestFalse(TEXT("Fire released"), Server->bFireButtonPressed);
+	TestEqual(TEXT("Ack covers the newest frame"), Server->CombatAck.InputSequence, static_cast<uint16>(4));
+
+	// A duplicate of an old packet arriving late changes nothing
+	Server->ServerCombatInput_Implementation(First);
+	TestEqual(TEXT("Late duplicate ignored"), Server->LastInputSequence, static_cast<uint16>(4));
+	TestFalse(TEXT("Late duplicate does not aim"), Server->bIsAiming);
+
+	// Sequences wrap around
+	Server->LastInputSequence = MAX_uint16;
+	Server->ServerCombatInput_Implementation(MakePacket(1, { InputButton_Aim, InputButton_Aim }));
+	TestEqual(TEXT("Wrapped sequence applied"), Server->LastInputSequence, static_cast<uint16>(1));
+	TestTrue(TEXT("Aiming after the wrap"), Server->bIsAiming);
+
+	return true;
+}
+
+#endif
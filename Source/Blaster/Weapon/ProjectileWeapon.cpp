@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProjectileWeapon.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "GameFramework/GameStateBase.h"
+
+AProjectileWeapon::AProjectileWeapon()
+{
+	MuzzleSocketName = FName("MuzzleFlash");
+}
+
+FBlasterProjectileSpawn AProjectileWeapon::MakeProjectileSpawn(const FVector& HitTarget) const
+{
+	const USkeletalMeshComponent* Mesh = GetWeaponMesh();
+	const FVector Origin = Mesh && Mesh->DoesSocketExist(MuzzleSocketName) ? Mesh->GetSocketLocation(MuzzleSocketName) : GetActorLocation();
+
+	FVector Direction = (HitTarget - Origin).GetSafeNormal();
+	if (Direction.IsZero())
+		Direction = GetActorForwardVector();
+
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	const double SpawnTime = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+
+	return FBlasterProjectileSpawn::Make(Origin, Direction, FMath::Rand(), SpawnTime);
+}
+
+void AProjectileWeapon::FireProjectile(const FBlasterProjectileSpawn& Spawn)
+{
+	Fire(Spawn.Origin + Spawn.GetDirection(0.f) * GetFireRange());
+
+	UBlasterProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UBlasterProjectileSubsystem>();
+	if (Projectiles)
+		Projectiles->SpawnProjectile(Spawn, ProjectileParams, this);
+}
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Weapon.h"
+#include "Blaster/BlasterSubsystems/BlasterProjectileSubsystem.h"
+#include "ProjectileWeapon.generated.h"
+
+/**
+ * Fires projectiles flown by UBlasterProjectileSubsystem instead of scoring hitscan shots.
+ * The server decides the shot and multicasts it as a spawn event, damage is applied on impact there.
+ */
+UCLASS()
+class BLASTER_API AProjectileWeapon : public AWeapon
+{
+	GENERATED_BODY()
+
+public:
+	AProjectileWeapon();
+
+	// Server side, quantized and seeded so every machine flies the same shot
+	FBlasterProjectileSpawn MakeProjectileSpawn(const FVector& HitTarget) const;
+
+	void FireProjectile(const FBlasterProjectileSpawn& Spawn);
+
+private:
+	UPROPERTY(EditAnywhere, Category = "Weapon Properties")
+	FBlasterProjectileParams ProjectileParams;
+
+	UPROPERTY(EditAnywhere, Category = "Weapon Properties")
+	FName MuzzleSocketName;
+};
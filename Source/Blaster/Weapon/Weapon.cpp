@@ -3,14 +3,56 @@
 
 #include "Weapon.h"
 #include "Components/SphereComponent.h"
-#include "Components/WidgetComponent.h"
 #include "Blaster/Character/BlasterCharacter.h"
+#include "Blaster/BlasterSubsystems/BlasterTickSubsystem.h"
+#include "Blaster/BlasterSubsystems/BlasterPickupSubsystem.h"
+#include "Blaster/BlasterSubsystems/BlasterWeaponPoolSubsystem.h"
+#include "Blaster/HUD/BlasterHUD.h"
+#include "GameFramework/PlayerController.h"
 #include "Net/UnrealNetwork.h"
+#include "Blaster/Blaster.h"
+#include "EngineUtils.h"
+#include "Animation/AnimationAsset.h"
+#include "TimerManager.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Push Compares Skipped (Weapon)"), STAT_BlasterPushSkippedWeapon, STATGROUP_Blaster);
+
+static void DumpWeaponDormancy(UWorld* World)
+{
+	if (!World)
+		return;
+
+	int32 NumDormant = 0;
+	int32 NumPooled = 0;
+	int32 NumAwake = 0;
+	for (TActorIterator<AWeapon> It(World); It; ++It)
+	{
+		if (It->NetDormancy > DORM_Awake)
+		{
+			++NumDormant;
+			if (It->IsHidden())
+				++NumPooled;
+		}
+		else
+		{
+			++NumAwake;
+		}
+	}
+
+	UE_LOG(LogBlaster, Display, TEXT("Weapons: %d dormant (%d of them pooled), %d awake%s"), NumDormant, NumPooled, NumAwake,
+		World->GetNetMode() == NM_Client ? TEXT(" - dormancy is only driven on the server") : TEXT(""));
+}
+
+static FAutoConsoleCommandWithWorld DumpWeaponDormancyCommand(
+	TEXT("Blaster.DumpWeaponDormancy"),
+	TEXT("Logs how many weapons are net dormant and how many are awake"),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&DumpWeaponDormancy));
 
 // Sets default values
 AWeapon::AWeapon()
 {
- 	PrimaryActorTick.bCanEverTick = true;
+	// Nothing to do per frame, UBlasterTickSubsystem toggles the mesh tick with the weapon state
+	PrimaryActorTick.bCanEverTick = false;
 	bReplicates = true;
 
 	WeaponMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("Weapon Mesh"));
@@ -25,8 +67,17 @@ AWeapon::AWeapon()
 	AreaSphere->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
 	AreaSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 
-	PickupWidget = CreateDefaultSubobject<UWidgetComponent>(TEXT("Pick Up Widget"));
-	PickupWidget->SetupAttachment(RootComponent);
+	Damage = 20.f;
+	FireRange = 80000.f;
+	FireInterval = 0.15f;
+
+	// Placed weapons start out dormant, clients already have them from the map
+	NetDormancy = DORM_Initial;
+	DroppedLifetime = 30.f;
+	bHoldAwake = false;
+
+	// UBlasterReplicationGraph reads this once per class, an equipped weapon replicates with its holder instead
+	NetUpdateFrequency = 2.f;
 }
 
 void AWeapon::BeginPlay()
@@ -34,14 +85,37 @@ void AWeapon::BeginPlay()
 	Super::BeginPlay();
 	if (HasAuthority())
 	{
-		AreaSphere->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-		AreaSphere->SetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn, ECollisionResponse::ECR_Overlap);
-		AreaSphere->OnComponentBeginOverlap.AddDynamic(this, &AWeapon::OnSphereOverlap);
-		AreaSphere->OnComponentEndOverlap.AddDynamic(this, &AWeapon::OnSphereEndOverlap);
+		UBlasterPickupSubsystem* PickupGrid = GetPickupGrid();
+		if (PickupGrid)
+		{
+			PickupGrid->UpdateWeapon(this);
+		}
+		else
+		{
+			AreaSphere->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+			AreaSphere->SetCollisionResponseToChannel(ECollisionChannel::ECC_Pawn, ECollisionResponse::ECR_Overlap);
+			AreaSphere->OnComponentBeginOverlap.AddDynamic(this, &AWeapon::OnSphereOverlap);
+			AreaSphere->OnComponentEndOverlap.AddDynamic(this, &AWeapon::OnSphereEndOverlap);
+		}
+		UpdateNetDormancy();
 	}
 
-	if (PickupWidget)
-		PickupWidget->SetVisibility(false);
+	UBlasterTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UBlasterTickSubsystem>();
+	if (TickSubsystem)
+		TickSubsystem->RegisterWeapon(this);
+}
+
+void AWeapon::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UBlasterPickupSubsystem* PickupGrid = GetPickupGrid();
+	if (PickupGrid)
+		PickupGrid->RemoveWeapon(this);
+
+	UBlasterTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UBlasterTickSubsystem>();
+	if (TickSubsystem)
+		TickSubsystem->UnregisterWeapon(this);
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AWeapon::OnSphereOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
@@ -66,11 +140,17 @@ void AWeapon::OnRep_WeaponState()
 		ShowPickupWidget(false);
 		break;
 	}
+
+	UBlasterTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UBlasterTickSubsystem>();
+	if (TickSubsystem)
+		TickSubsystem->OnWeaponStateChanged(this);
 }
 
 void AWeapon::SetWeaponState(EWeaponState State)
 {
 	WeaponState = State;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AWeapon, WeaponState, this);
+	PushModelTracker.MarkDirty(PushProperty_WeaponState);
 
 	switch (WeaponState)
 	{
@@ -78,25 +158,144 @@ void AWeapon::SetWeaponState(EWeaponState State)
 		ShowPickupWidget(false);
 		AreaSphere->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 		break;
+	case EWeaponState::EWS_Dropped:
+		// The pickup grid takes it back below, otherwise overlaps have to find it again
+		if (HasAuthority() && !GetPickupGrid())
+			AreaSphere->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+		break;
+	}
+
+	UpdateNetDormancy();
+
+	if (HasAuthority())
+	{
+		if (WeaponState == EWeaponState::EWS_Dropped && DroppedLifetime > 0.f)
+			GetWorldTimerManager().SetTimer(ReturnToPoolTimer, this, &AWeapon::ReturnToPool, DroppedLifetime);
+		else
+			GetWorldTimerManager().ClearTimer(ReturnToPoolTimer);
+	}
+
+	UBlasterPickupSubsystem* PickupGrid = GetPickupGrid();
+	if (PickupGrid)
+		PickupGrid->UpdateWeapon(this);
+
+	UBlasterTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UBlasterTickSubsystem>();
+	if (TickSubsystem)
+		TickSubsystem->OnWeaponStateChanged(this);
+}
+
+UBlasterPickupSubsystem* AWeapon::GetPickupGrid() const
+{
+	UBlasterPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UBlasterPickupSubsystem>();
+	return PickupSubsystem && PickupSubsystem->IsGridEnabled() ? PickupSubsystem : nullptr;
+}
+
+void AWeapon::UpdateNetDormancy()
+{
+	if (!HasAuthority())
+		return;
+
+	// The property change made by the caller still goes out, a channel only closes once its last update was acked
+	if (WeaponState == EWeaponState::EWS_Equipped || bHoldAwake)
+	{
+		SetNetDormancy(DORM_Awake);
 	}
+	else
+	{
+		// Untouched placed weapons keep DORM_Initial and never open a channel at all
+		if (NetDormancy != DORM_Initial || !IsNetStartupActor())
+			SetNetDormancy(DORM_DormantAll);
+	}
+}
+
+void AWeapon::WakeForPoolTransition()
+{
+	// The replication graph only moves a dormant actor to another grid cell when its dormancy changes,
+	// so the weapon is awake while it moves and goes back to sleep once the move has been replicated
+	bHoldAwake = true;
+	SetNetDormancy(DORM_Awake);
+	GetWorldTimerManager().SetTimerForNextTick(this, &AWeapon::FinishPoolTransition);
+}
+
+void AWeapon::FinishPoolTransition()
+{
+	bHoldAwake = false;
+	UpdateNetDormancy();
 }
 
-void AWeapon::Tick(float DeltaTime)
+void AWeapon::ReturnToPool()
 {
-	Super::Tick(DeltaTime);
+	if (WeaponState != EWeaponState::EWS_Dropped)
+		return;
 
+	UBlasterWeaponPoolSubsystem* WeaponPool = GetWorld()->GetSubsystem<UBlasterWeaponPoolSubsystem>();
+	if (WeaponPool)
+		WeaponPool->ReleaseWeapon(this);
+}
+
+void AWeapon::EnterPool()
+{
+	WakeForPoolTransition();
+
+	DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+	SetOwner(nullptr);
+	PoolOwner.Reset();
+	SetWeaponState(EWeaponState::EWS_Initial);
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+
+	// Hidden weapons leave the pickup grid
+	UBlasterPickupSubsystem* PickupGrid = GetPickupGrid();
+	if (PickupGrid)
+		PickupGrid->UpdateWeapon(this);
+}
+
+void AWeapon::LeavePool(const FTransform& Transform, AActor* InPoolOwner)
+{
+	WakeForPoolTransition();
+
+	PoolOwner = InPoolOwner;
+	SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+	SetWeaponState(EWeaponState::EWS_Initial);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	// Shown weapons enter the pickup grid at their new location
+	UBlasterPickupSubsystem* PickupGrid = GetPickupGrid();
+	if (PickupGrid)
+		PickupGrid->UpdateWeapon(this);
+	else
+		AreaSphere->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 }
 
 void AWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
   Super::GetLifetimeReplicatedProps(OutLifetimeProps);
-  
-  DOREPLIFETIME(AWeapon, WeaponState);
+
+  FDoRepLifetimeParams Params;
+  Params.bIsPushBased = true;
+  DOREPLIFETIME_WITH_PARAMS_FAST(AWeapon, WeaponState, Params);
+}
+
+void AWeapon::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	INC_DWORD_STAT_BY(STAT_BlasterPushSkippedWeapon, PushModelTracker.ConsumeSkipped(PushProperty_MAX));
 }
 
 void AWeapon::ShowPickupWidget(bool bShowWidget)
 {
-	if(PickupWidget)
-	  PickupWidget->SetVisibility(bShowWidget);
+	// Only the local player overlaps weapons for a prompt, ABlasterHUD draws it
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	ABlasterHUD* HUD = PlayerController ? Cast<ABlasterHUD>(PlayerController->GetHUD()) : nullptr;
+	if (HUD)
+		HUD->ShowPickupPrompt(this, bShowWidget);
+}
+
+void AWeapon::Fire(const FVector& HitTarget)
+{
+	if (FireAnimation)
+		WeaponMesh->PlayAnimation(FireAnimation, false);
 }
 
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Blaster/BlasterNet/BlasterPushModel.h"
 #include "Weapon.generated.h"
 
 UENUM(BlueprintType)
@@ -22,12 +23,14 @@ class BLASTER_API AWeapon : public AActor
 	
 public:	
 	AWeapon();
-	virtual void Tick(float DeltaTime) override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 	void ShowPickupWidget(bool bShowWidget);
+	virtual void Fire(const FVector& HitTarget);
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UFUNCTION()
 	virtual void OnSphereOverlap(
@@ -60,11 +63,58 @@ private:
 	UFUNCTION()
 	void OnRep_WeaponState();
 
-	UPROPERTY(VisibleAnywhere, Category = "Weapon Properties")
-	class UWidgetComponent* PickupWidget;
+	// Never created since the pickup prompt moved to ABlasterHUD, kept until the Blueprints that reference it are re-saved
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "The pickup prompt is drawn by ABlasterHUD, see ShowPickupWidget"))
+	class UWidgetComponent* PickupWidget_DEPRECATED;
+
+	UPROPERTY(EditAnywhere, Category = "Weapon Properties")
+	class UAnimationAsset* FireAnimation;
+
+	UPROPERTY(EditAnywhere, Category = "Weapon Properties")
+	float Damage;
+
+	UPROPERTY(EditAnywhere, Category = "Weapon Properties")
+	float FireRange;
+
+	// Minimum time between two shots, the server drops shots and score requests that come faster
+	UPROPERTY(EditAnywhere, Category = "Weapon Properties")
+	float FireInterval;
+
+	// A dropped weapon nobody picks up within this time goes back to UBlasterWeaponPoolSubsystem, 0 keeps it
+	UPROPERTY(EditAnywhere, Category = "Weapon Properties")
+	float DroppedLifetime;
+
+	FTimerHandle ReturnToPoolTimer;
+
+	// Set while a pool transition keeps the weapon awake, until its move has been sent
+	bool bHoldAwake;
+
+	// Whoever took the weapon out of the pool, cleared when it goes back
+	TWeakObjectPtr<AActor> PoolOwner;
+
+	void UpdateNetDormancy();
+	void WakeForPoolTransition();
+	void FinishPoolTransition();
+	void ReturnToPool();
+
+	// Returns the pickup subsystem when it replaces the AreaSphere overlaps
+	class UBlasterPickupSubsystem* GetPickupGrid() const;
+
+	enum EPushProperty { PushProperty_WeaponState, PushProperty_MAX };
+	FBlasterPushModelTracker PushModelTracker;
 
 public:	
 	void SetWeaponState(EWeaponState State);
+
+	// Park the weapon for UBlasterWeaponPoolSubsystem or bring it back into play at Transform for InPoolOwner, server only
+	void EnterPool();
+	void LeavePool(const FTransform& Transform, AActor* InPoolOwner);
+
+	FORCEINLINE EWeaponState GetWeaponState() const { return WeaponState; }
 	FORCEINLINE USphereComponent* GetAreaSphere() const { return AreaSphere; }
 	FORCEINLINE USkeletalMeshComponent* GetWeaponMesh() const { return WeaponMesh; }
+	FORCEINLINE float GetDamage() const { return Damage; }
+	FORCEINLINE float GetFireRange() const { return FireRange; }
+	FORCEINLINE float GetFireInterval() const { return FireInterval; }
+	FORCEINLINE AActor* GetPoolOwner() const { return PoolOwner.Get(); }
 };
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WeaponSpawnPoint.h"
+#include "Weapon.h"
+#include "Blaster/BlasterSubsystems/BlasterWeaponPoolSubsystem.h"
+#include "TimerManager.h"
+
+AWeaponSpawnPoint::AWeaponSpawnPoint()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	SetRootComponent(CreateDefaultSubobject<USceneComponent>(TEXT("Root")));
+
+	RespawnDelay = 10.f;
+}
+
+void AWeaponSpawnPoint::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (!HasAuthority())
+		return;
+
+	CheckWeapon();
+
+	// Cheaper than hooking every state change, a pickup only needs to be noticed within RespawnDelay
+	GetWorldTimerManager().SetTimer(CheckWeaponTimer, this, &AWeaponSpawnPoint::CheckWeapon, FMath::Max(RespawnDelay, 0.1f), true);
+}
+
+void AWeaponSpawnPoint::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	GetWorldTimerManager().ClearTimer(CheckWeaponTimer);
+
+	// Hand an untouched weapon back when the spawn point goes away mid match
+	if (EndPlayReason == EEndPlayReason::Destroyed && HasUntouchedWeapon())
+	{
+		UBlasterWeaponPoolSubsystem* WeaponPool = GetWorld()->GetSubsystem<UBlasterWeaponPoolSubsystem>();
+		if (WeaponPool)
+			WeaponPool->ReleaseWeapon(SpawnedWeapon);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool AWeaponSpawnPoint::HasUntouchedWeapon() const
+{
+	// Pooled weapons are EWS_Initial as well, a hidden one or one acquired by someone else is no longer ours
+	return IsValid(SpawnedWeapon)
+		&& SpawnedWeapon->GetWeaponState() == EWeaponState::EWS_Initial
+		&& !SpawnedWeapon->IsHidden()
+		&& SpawnedWeapon->GetPoolOwner() == this;
+}
+
+void AWeaponSpawnPoint::CheckWeapon()
+{
+	if (HasUntouchedWeapon())
+		return;
+
+	UBlasterWeaponPoolSubsystem* WeaponPool = GetWorld()->GetSubsystem<UBlasterWeaponPoolSubsystem>();
+	if (WeaponPool)
+		SpawnedWeapon = WeaponPool->AcquireWeapon(WeaponClass, GetActorTransform(), this);
+}
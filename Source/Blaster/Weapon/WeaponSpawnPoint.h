@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "WeaponSpawnPoint.generated.h"
+
+class AWeapon;
+
+/**
+ * Keeps a weapon lying at this point, taken from UBlasterWeaponPoolSubsystem.
+ * Once it has been picked up, a new one is acquired within RespawnDelay.
+ */
+UCLASS()
+class BLASTER_API AWeaponSpawnPoint : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AWeaponSpawnPoint();
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	void CheckWeapon();
+
+	// True while SpawnedWeapon is still lying here untouched, rather than picked up or recycled by the pool
+	bool HasUntouchedWeapon() const;
+
+	UPROPERTY(EditAnywhere, Category = "Spawn")
+	TSubclassOf<AWeapon> WeaponClass;
+
+	UPROPERTY(EditAnywhere, Category = "Spawn")
+	float RespawnDelay;
+
+	UPROPERTY()
+	AWeapon* SpawnedWeapon;
+
+	FTimerHandle CheckWeaponTimer;
+};
@@ -11,5 +11,6 @@ public class BlasterEditorTarget : TargetRules
 		DefaultBuildSettings = BuildSettingsVersion.V2;
 		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_1;
 		ExtraModuleNames.Add("Blaster");
+		bWithPushModel = true;
 	}
 }